@@ -0,0 +1,392 @@
+#ifndef KAORI_BAM_READER_HPP
+#define KAORI_BAM_READER_HPP
+
+#include "byteme/Reader.hpp"
+#include "ReadField.hpp"
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @file BamReader.hpp
+ *
+ * @brief Defines the `BamReader` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Stream reads from a BAM file.
+ *
+ * This has the same interface as `FastqReader`, so it can be used in its place in `process_single_end_data()` and `process_paired_end_data()`.
+ * It is primarily intended for unaligned BAM files, which are sometimes used by sequencing facilities instead of FASTQ.
+ * For paired-end data in an unaligned BAM file, the mates are usually interleaved, so the single-input overload of `process_paired_end_data()` can be used.
+ *
+ * The `byteme::Reader` should supply the decompressed contents of the BAM file, e.g., via `ParallelGzipReader`.
+ * By default, each sequence is decoded from the BAM's 4-bit packed representation as it is streamed from the buffer, without an intermediate copy of the record.
+ * If `views = true` in the constructor, decoding is deferred until the sequence is requested,
+ * so that `append_sequence()` can decode each sequence directly into the caller's buffer.
+ *
+ * Secondary and supplementary alignments are skipped so that each read is only reported once.
+ * Reads that are aligned to the reverse strand are reverse-complemented to recover the sequence in its original orientation.
+ *
+ * @tparam store_names Whether to extract the name of each read.
+ * If `false`, names are skipped and `get_name()` and `get_name_view()` will always be empty.
+ */
+template<bool store_names = true>
+class BamReader {
+public:
+    /**
+     * @param p Any `byteme::Reader` instance that supplies the decompressed contents of a BAM file.
+     * @param views Whether to avoid copying the name and the packed sequence of each read.
+     * If `true`, these are borrowed from the buffer of the `byteme::Reader` where possible,
+     * and the sequence is only decoded by `append_sequence()` or on the first call to `get_sequence()` or `get_sequence_view()` for each read.
+     */
+    BamReader(byteme::Reader* p, bool views = false) : ptr(p), use_views(views) {
+        sequence.store.reserve(200);
+        if constexpr(store_names) {
+            name.store.reserve(200);
+        }
+
+        refresh();
+
+        unsigned char magic[4];
+        if (!fetch(magic, 4) || magic[0] != 'B' || magic[1] != 'A' || magic[2] != 'M' || magic[3] != 1) {
+            throw std::runtime_error("BAM file should start with the 'BAM\\1' magic string");
+        }
+
+        // Skipping the header text and the reference sequence dictionary.
+        skip(fetch_length());
+        int32_t n_ref = fetch_length();
+        for (int32_t r = 0; r < n_ref; ++r) {
+            skip(fetch_length());
+            skip(4);
+        }
+    }
+
+    /**
+     * Extract details for the next read in the file.
+     *
+     * @return Whether or not a record was successfully extracted.
+     * If `true`, `get_sequence()` and `get_name()` may be used.
+     * If `false`, this indicates that we reached the end of the file.
+     */
+    bool operator()() {
+        while (1) {
+            unsigned char block_size_raw[4];
+            if (!fetch(block_size_raw, 4)) {
+                return false;
+            }
+            int64_t remaining = decode_int32(block_size_raw);
+            ++record_count;
+
+            // Fixed-length fields: refID, pos, l_read_name, mapq, bin,
+            // n_cigar_op, flag, l_seq, next_refID, next_pos and tlen.
+            constexpr int fixed_size = 32;
+            unsigned char fixed[fixed_size];
+            remaining -= fixed_size;
+            if (remaining < 0 || !fetch(fixed, fixed_size)) {
+                throw_malformed();
+            }
+
+            size_t l_read_name = fixed[8];
+            size_t n_cigar_op = fixed[12] | (static_cast<size_t>(fixed[13]) << 8);
+            int flag = fixed[14] | (fixed[15] << 8);
+            int32_t l_seq = decode_int32(fixed + 16);
+            if (l_seq < 0) {
+                throw_malformed();
+            }
+            size_t l_packed = (static_cast<size_t>(l_seq) + 1) / 2;
+
+            remaining -= l_read_name + 4 * n_cigar_op + l_packed;
+            if (remaining < 0) {
+                throw_malformed();
+            }
+
+            if (flag & 0x900) {
+                skip(l_read_name + 4 * n_cigar_op + l_packed + remaining);
+                continue;
+            }
+
+            // Read names are NULL-terminated, which we don't want to keep.
+            name.clear();
+            if constexpr(store_names) {
+                if (l_read_name > 0) {
+                    fetch_field(name, l_read_name - 1);
+                    skip(1);
+                }
+            } else {
+                skip(l_read_name);
+            }
+
+            skip(4 * n_cigar_op);
+            sequence.clear();
+            sequence_length = l_seq;
+            sequence_reverse = flag & 0x10;
+            if (use_views) {
+                packed.clear();
+                fetch_field(packed, l_packed);
+                decoded = false;
+            } else {
+                decode_sequence();
+                decoded = true;
+            }
+            skip(remaining);
+            return true;
+        }
+    }
+
+private:
+    byteme::Reader* ptr;
+    bool use_views;
+    bool source_empty = false;
+
+    const unsigned char * buffer;
+    size_t available = 0;
+    size_t avail_pos = 0;
+    size_t record_count = 0;
+
+    void refresh() {
+        avail_pos = 0;
+        if (source_empty) {
+            available = 0;
+            return;
+        }
+
+        // The current buffer is about to be invalidated, so any views into
+        // it need to be copied into the fields' own storage.
+        if constexpr(store_names) {
+            name.detach();
+        }
+        packed.detach();
+
+        source_empty = !(ptr->operator()());
+        buffer = ptr->buffer();
+        available = ptr->available();
+    }
+
+    // Returns false if there are no more bytes at all, otherwise throws if
+    // the end of the file is reached partway through the requested bytes.
+    bool fetch(unsigned char* dest, size_t n) {
+        size_t copied = 0;
+        while (copied < n) {
+            if (avail_pos == available) {
+                refresh();
+                if (!available) {
+                    if (copied == 0) {
+                        return false;
+                    }
+                    throw_malformed();
+                }
+            }
+            size_t to_copy = std::min(n - copied, available - avail_pos);
+            std::copy(buffer + avail_pos, buffer + avail_pos + to_copy, dest + copied);
+            copied += to_copy;
+            avail_pos += to_copy;
+        }
+        return true;
+    }
+
+    void fetch_or_throw(unsigned char* dest, size_t n) {
+        if (n && !fetch(dest, n)) {
+            throw_malformed();
+        }
+    }
+
+    // Adds the next 'n' bytes to 'field', borrowing them from the buffer if views are requested.
+    void fetch_field(ReadField& field, size_t n) {
+        while (n) {
+            if (avail_pos == available) {
+                refresh();
+                if (!available) {
+                    throw_malformed();
+                }
+            }
+            size_t to_add = std::min(n, available - avail_pos);
+            const char* start = reinterpret_cast<const char*>(buffer + avail_pos);
+            field.add(start, start + to_add, use_views);
+            avail_pos += to_add;
+            n -= to_add;
+        }
+    }
+
+    void skip(size_t n) {
+        while (n) {
+            if (avail_pos == available) {
+                refresh();
+                if (!available) {
+                    throw_malformed();
+                }
+            }
+            size_t to_skip = std::min(n, available - avail_pos);
+            avail_pos += to_skip;
+            n -= to_skip;
+        }
+    }
+
+    static int32_t decode_int32(const unsigned char* src) {
+        uint32_t out = static_cast<uint32_t>(src[0]) |
+            (static_cast<uint32_t>(src[1]) << 8) |
+            (static_cast<uint32_t>(src[2]) << 16) |
+            (static_cast<uint32_t>(src[3]) << 24);
+        return static_cast<int32_t>(out);
+    }
+
+    int32_t fetch_length() {
+        unsigned char raw[4];
+        fetch_or_throw(raw, 4);
+        int32_t out = decode_int32(raw);
+        if (out < 0) {
+            throw_malformed();
+        }
+        return out;
+    }
+
+    // In the 4-bit encoding, the complement of each base is obtained by
+    // reversing the bits, so we can just use a different lookup table.
+    static constexpr const char* forward_codes = "=ACMGRSVTWYHKDBN";
+    static constexpr const char* reverse_codes = "=TGKCYSBAWRDMHVN";
+
+    void decode_sequence() {
+        size_t l_seq = sequence_length;
+        sequence.store.resize(l_seq);
+        char* out = sequence.store.data();
+        size_t l_packed = (l_seq + 1) / 2;
+
+        if (!sequence_reverse) {
+            size_t i = 0;
+            for (size_t b = 0; b < l_packed; ++b) {
+                unsigned char current = next_byte();
+                out[i++] = forward_codes[current >> 4];
+                if (i < l_seq) {
+                    out[i++] = forward_codes[current & 0xf];
+                }
+            }
+        } else {
+            size_t i = l_seq;
+            for (size_t b = 0; b < l_packed; ++b) {
+                unsigned char current = next_byte();
+                out[--i] = reverse_codes[current >> 4];
+                if (i > 0) {
+                    out[--i] = reverse_codes[current & 0xf];
+                }
+            }
+        }
+    }
+
+    // Decodes positions [from, to) of the read sequence from the packed bytes into 'out'.
+    void decode_packed(size_t from, size_t to, char* out) const {
+        const unsigned char* src = reinterpret_cast<const unsigned char*>(packed.view().first);
+        auto nibble = [&](size_t j) -> unsigned char {
+            unsigned char current = src[j / 2];
+            return (j % 2 == 0 ? current >> 4 : current & 0xf);
+        };
+
+        if (!sequence_reverse) {
+            for (size_t i = from; i < to; ++i) {
+                *(out++) = forward_codes[nibble(i)];
+            }
+        } else {
+            for (size_t i = from; i < to; ++i) {
+                *(out++) = reverse_codes[nibble(sequence_length - i - 1)];
+            }
+        }
+    }
+
+    const ReadField& decoded_sequence() const {
+        if (!decoded) {
+            sequence.store.resize(sequence_length);
+            decode_packed(0, sequence_length, sequence.store.data());
+            decoded = true;
+        }
+        return sequence;
+    }
+
+    unsigned char next_byte() {
+        if (avail_pos == available) {
+            refresh();
+            if (!available) {
+                throw_malformed();
+            }
+        }
+        return buffer[avail_pos++];
+    }
+
+    [[noreturn]] void throw_malformed() const {
+        if (record_count == 0) {
+            throw std::runtime_error("malformed or truncated BAM header");
+        }
+        throw std::runtime_error("malformed or truncated BAM record " + std::to_string(record_count));
+    }
+
+private:
+    // The decoded sequence is only filled on request if views are used.
+    ReadField sequence, packed;
+    size_t sequence_length = 0;
+    bool sequence_reverse = false;
+    mutable bool decoded = false;
+    ReadField name;
+
+public:
+    /**
+     * @return Vector containing the sequence for the current read.
+     */
+    const std::vector<char>& get_sequence() const {
+        return decoded_sequence().stored();
+    }
+
+    /**
+     * @return Vector containing the name for the current read.
+     */
+    const std::vector<char>& get_name() const {
+        return name.stored();
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the sequence for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_sequence_view() const {
+        return decoded_sequence().view();
+    }
+
+    /**
+     * Append part of the sequence for the current read to a vector.
+     * If `views = true` in the constructor, the sequence is decoded directly into `destination`, so it is never copied.
+     * This is used by `process_single_end_data()` and friends to fill each block of reads.
+     *
+     * @param[out] destination Vector to which to append the sequence.
+     * @param window_start Position on the read at which to start the window.
+     * @param window_end Position on the read at which to end the window.
+     *
+     * @return The part of the sequence in `[window_start, window_end)` is appended to `destination`.
+     * This is truncated at the end of the read.
+     */
+    void append_sequence(std::vector<char>& destination, size_t window_start = 0, size_t window_end = static_cast<size_t>(-1)) const {
+        size_t from = std::min(window_start, sequence_length);
+        size_t to = std::max(from, std::min(window_end, sequence_length));
+        size_t offset = destination.size();
+        destination.resize(offset + (to - from));
+        if (decoded) {
+            auto current = sequence.view();
+            std::copy(current.first + from, current.first + to, destination.data() + offset);
+        } else {
+            decode_packed(from, to, destination.data() + offset);
+        }
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the name for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_name_view() const {
+        return name.view();
+    }
+};
+
+}
+
+#endif
@@ -4,10 +4,14 @@
 #include "BarcodePool.hpp"
 #include "MismatchTrie.hpp"
 #include "utils.hpp"
+#include "SearchStats.hpp"
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
 /**
  * @file BarcodeSearch.hpp
@@ -58,6 +62,62 @@ void fill_library(
     return;
 }
 
+// Cache of mismatching sequences that is shared across threads. search() only
+// reads an immutable snapshot, so reduce() can merge new entries from a
+// thread-specific state while other threads are still searching. New entries
+// are collected in 'pending' and published as a new snapshot once they are a
+// sizable fraction of the current one; this keeps the total cost of copying
+// linear in the final size of the cache.
+template<class Value>
+class SharedCache {
+public:
+    typedef std::unordered_map<std::string, Value> Map;
+
+    SharedCache() : published(std::make_shared<const Map>()) {}
+
+    SharedCache(const SharedCache& other) : published(std::atomic_load(&(other.published))), pending(other.pending), version(other.version.load()) {}
+
+    SharedCache& operator=(const SharedCache& other) {
+        std::atomic_store(&published, std::atomic_load(&(other.published)));
+        pending = other.pending;
+        version.store(other.version.load());
+        return *this;
+    }
+
+    // Held by each thread-specific state, to avoid reloading the snapshot
+    // unless a new one has been published.
+    struct Reader {
+        std::shared_ptr<const Map> snapshot;
+        uint64_t version = static_cast<uint64_t>(-1);
+    };
+
+    const Map& snapshot(Reader& reader) const {
+        auto current = version.load(std::memory_order_acquire);
+        if (current != reader.version) {
+            reader.snapshot = std::atomic_load(&published);
+            reader.version = current;
+        }
+        return *(reader.snapshot);
+    }
+
+    void merge(Map& local) {
+        pending.merge(local);
+        local.clear();
+        if (pending.size() * 4 >= published->size()) {
+            auto next = std::make_shared<Map>(*published);
+            next->merge(pending);
+            pending.clear();
+            std::atomic_store(&published, std::shared_ptr<const Map>(std::move(next)));
+            version.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+private:
+    std::shared_ptr<const Map> published;
+    Map pending;
+    std::atomic<uint64_t> version{0};
+};
+
 template<class Methods, class Cache, class Trie, class Result, class Mismatch>
 void matcher_in_the_rye(const std::string& x, const Cache& cache, const Trie& trie, Result& res, const Mismatch& mismatches, const Mismatch& max_mismatches) {
     // Seeing if it's any of the caches; otherwise searching the trie.
@@ -65,9 +125,12 @@ void matcher_in_the_rye(const std::string& x, const Cache& cache, const Trie& tr
     if (cit == cache.end()) {
         auto lit = res.cache.find(x);
         if (lit != res.cache.end()) {
+            KAORI_COUNT(res, cache_hits);
             Methods::update(res, lit->second, mismatches);
 
         } else {
+            KAORI_COUNT(res, trie_searches);
+            KAORI_TIME(res, trie_time);
             auto missed = trie.search(x.c_str(), mismatches);
 
             // The trie search breaks early when it hits the mismatch cap,
@@ -86,6 +149,7 @@ void matcher_in_the_rye(const std::string& x, const Cache& cache, const Trie& tr
             Methods::update(res, missed);
         }
     } else {
+        KAORI_COUNT(res, cache_hits);
         Methods::update(res, cit->second, mismatches);
     }
     return;
@@ -146,6 +210,10 @@ public:
          * @cond
          */
         std::unordered_map<std::string, std::pair<int, int> > cache;
+        typename SharedCache<std::pair<int, int> >::Reader shared;
+#ifdef KAORI_INSTRUMENT
+        SearchStats stats;
+#endif
         /**
          * @endcond
          */
@@ -163,6 +231,7 @@ public:
     /**
      * Incorporate the mismatch cache from `state` into the cache for this `SimpleBarcodeSearch` instance.
      * This allows regular consolidation of optimizations across threads.
+     * It is safe to call this method while `search()` is running on other threads, but calls to `reduce()` should not overlap.
      *
      * @param state A state object generated by `initialize()`.
      * Typically this has already been used in `search()` at least once.
@@ -171,8 +240,21 @@ public:
      */
     void reduce(State& state) {
         cache.merge(state.cache);
-        state.cache.clear();
+#ifdef KAORI_INSTRUMENT
+        stats += state.stats;
+        state.stats = SearchStats();
+#endif
+    }
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Search statistics from all states that have been passed to `reduce()`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    const SearchStats& get_stats() const {
+        return stats;
     }
+#endif
 
 private:
     struct Methods {
@@ -223,20 +305,25 @@ public:
      * @return `state` is filled with the details of the best-matching barcode sequence, if any exists.
      */
     void search(const std::string& search_seq, State& state, int allowed_mismatches) const {
+        KAORI_COUNT(state, searches);
         auto it = exact.find(search_seq);
         if (it != exact.end()) {
+            KAORI_COUNT(state, exact_hits);
             state.index = it->second;
             state.mismatches = 0;
         } else {
-            matcher_in_the_rye<Methods>(search_seq, cache, trie, state, allowed_mismatches, max_mm);
+            matcher_in_the_rye<Methods>(search_seq, cache.snapshot(state.shared), trie, state, allowed_mismatches, max_mm);
         }
     }
 
 private:
     std::unordered_map<std::string, int> exact;
     AnyMismatches trie;
-    std::unordered_map<std::string, std::pair<int, int> > cache;
+    SharedCache<std::pair<int, int> > cache;
     int max_mm;
+#ifdef KAORI_INSTRUMENT
+    SearchStats stats;
+#endif
 };
 
 /**
@@ -329,6 +416,10 @@ public:
         State() : per_segment() {}
 
         std::unordered_map<std::string, typename SegmentedMismatches<num_segments>::Result> cache;
+        typename SharedCache<typename SegmentedMismatches<num_segments>::Result>::Reader shared;
+#ifdef KAORI_INSTRUMENT
+        SearchStats stats;
+#endif
         /**
          * @endcond
          */
@@ -346,6 +437,7 @@ public:
     /**
      * Incorporate the mismatch cache from `state` into the cache for this `SimpleBarcodeSearch` instance.
      * This allows regular consolidation of optimizations across threads.
+     * It is safe to call this method while `search()` is running on other threads, but calls to `reduce()` should not overlap.
      *
      * @param state A state object generated by `initialize()`.
      * Typically this has already been used in `search()`.
@@ -354,8 +446,21 @@ public:
      */
     void reduce(State& state) {
         cache.merge(state.cache);
-        state.cache.clear();
+#ifdef KAORI_INSTRUMENT
+        stats += state.stats;
+        state.stats = SearchStats();
+#endif
+    }
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Search statistics from all states that have been passed to `reduce()`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    const SearchStats& get_stats() const {
+        return stats;
     }
+#endif
 
 private:
     typedef typename SegmentedMismatches<num_segments>::Result SegmentedResult;
@@ -410,21 +515,26 @@ public:
      * @return `state` is filled with the details of the best-matching barcode sequence, if any exists.
      */
     void search(const std::string& search_seq, State& state, std::array<int, num_segments> allowed_mismatches) const {
+        KAORI_COUNT(state, searches);
         auto it = exact.find(search_seq);
         if (it != exact.end()) {
+            KAORI_COUNT(state, exact_hits);
             state.index = it->second;
             state.mismatches = 0;
             std::fill_n(state.per_segment.begin(), num_segments, 0);
         } else {
-            matcher_in_the_rye<Methods>(search_seq, cache, trie, state, allowed_mismatches, max_mm);
+            matcher_in_the_rye<Methods>(search_seq, cache.snapshot(state.shared), trie, state, allowed_mismatches, max_mm);
         }
     }
 
 private:
     std::unordered_map<std::string, int> exact;
     SegmentedMismatches<num_segments> trie;
-    std::unordered_map<std::string, SegmentedResult> cache;
+    SharedCache<SegmentedResult> cache;
     std::array<int, num_segments> max_mm;
+#ifdef KAORI_INSTRUMENT
+    SearchStats stats;
+#endif
 };
 
 }
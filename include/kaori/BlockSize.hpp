@@ -0,0 +1,230 @@
+#ifndef KAORI_BLOCK_SIZE_HPP
+#define KAORI_BLOCK_SIZE_HPP
+
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+#include "Progress.hpp"
+
+/**
+ * @file BlockSize.hpp
+ *
+ * @brief Defines the `BlockSize` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Size of the blocks of reads in `process_single_end_data()` and `process_paired_end_data()`.
+ *
+ * By default, each block contains a fixed number of reads.
+ * The memory usage of each block can be bounded with `set_max_bytes()`,
+ * and the number of reads can be tuned at run time with `set_adaptive()`.
+ * In both cases, the number of reads in the next block is chosen from the average read length and per-read timings of the previous blocks.
+ * The first block only contains `get_min_reads()` reads, to collect these statistics.
+ */
+class BlockSize {
+public:
+    /**
+     * @param max_reads Maximum number of reads in each block.
+     * If neither `set_max_bytes()` nor `set_adaptive()` are used, every block (except the last) will contain this many reads.
+     */
+    BlockSize(int max_reads = 100000) : max_reads(max_reads) {
+        if (max_reads < 1) {
+            throw std::runtime_error("block size should be positive");
+        }
+    }
+
+    /**
+     * @param b Approximate maximum number of bytes of sequence (and name) data in each block.
+     * If zero, no limit is applied.
+     *
+     * @return A reference to this `BlockSize` instance.
+     */
+    BlockSize& set_max_bytes(size_t b = 0) {
+        max_bytes = b;
+        return *this;
+    }
+
+    /**
+     * @param a Whether to adapt the number of reads in each block based on the measured time to parse and process each read.
+     * Blocks are sized so that the slower of the two steps takes approximately `get_target_time()` seconds per block.
+     * This amortizes the synchronization overhead for cheap handlers while avoiding long tails for expensive ones.
+     *
+     * @return A reference to this `BlockSize` instance.
+     */
+    BlockSize& set_adaptive(bool a = true) {
+        adaptive = a;
+        return *this;
+    }
+
+    /**
+     * @param t Target time in seconds to parse or process each block, when `set_adaptive()` is used.
+     *
+     * @return A reference to this `BlockSize` instance.
+     */
+    BlockSize& set_target_time(double t = 0.02) {
+        target_time = t;
+        return *this;
+    }
+
+    /**
+     * @param m Minimum number of reads in each block (except the last) when `set_adaptive()` is used.
+     * This is also the size of the first block when `set_adaptive()` or `set_max_bytes()` is used.
+     *
+     * @return A reference to this `BlockSize` instance.
+     */
+    BlockSize& set_min_reads(int m = 1000) {
+        min_reads = m;
+        return *this;
+    }
+
+public:
+    /**
+     * @return Maximum number of reads in each block.
+     */
+    int get_max_reads() const {
+        return max_reads;
+    }
+
+    /**
+     * @return Approximate maximum number of bytes in each block, or zero if there is no limit.
+     */
+    size_t get_max_bytes() const {
+        return max_bytes;
+    }
+
+    /**
+     * @return Whether the block size is adapted at run time.
+     */
+    bool get_adaptive() const {
+        return adaptive;
+    }
+
+    /**
+     * @return Target time in seconds for each block.
+     */
+    double get_target_time() const {
+        return target_time;
+    }
+
+    /**
+     * @return Minimum number of reads in each block.
+     */
+    int get_min_reads() const {
+        return min_reads;
+    }
+
+private:
+    int max_reads;
+    size_t max_bytes = 0;
+    bool adaptive = false;
+    double target_time = 0.02;
+    int min_reads = 1000;
+};
+
+/**
+ * @cond
+ */
+// Chooses the number of reads in each block from a BlockSize and the
+// statistics of previous blocks, and keeps running totals for progress
+// reports. The parser, workers and reducer call this from different
+// threads, so everything is protected by a mutex; this is only touched
+// once per block so contention is negligible.
+class BlockTracker {
+public:
+    BlockTracker(const BlockSize& spec) : spec(spec), start(std::chrono::steady_clock::now()) {}
+
+    int next() const {
+        std::lock_guard<std::mutex> lck(mut);
+        int limit = spec.get_max_reads();
+        if (!spec.get_max_bytes() && !spec.get_adaptive()) {
+            return limit;
+        }
+
+        int floor = std::max(std::min(spec.get_min_reads(), limit), 1);
+        if (parsed_reads == 0 || (spec.get_adaptive() && !process_reads_timed)) {
+            return floor;
+        }
+
+        if (spec.get_max_bytes()) {
+            double bytes_per_read = static_cast<double>(parsed_bytes) / parsed_reads;
+            double allowed = spec.get_max_bytes() / std::max(bytes_per_read, 1.0);
+            limit = std::max(1, static_cast<int>(std::min(allowed, static_cast<double>(limit))));
+        }
+
+        if (spec.get_adaptive()) {
+            double cost = std::max(parse_time / parse_reads_timed, process_time / process_reads_timed);
+            if (cost > 0) {
+                double allowed = spec.get_target_time() / cost;
+                limit = std::max(floor, static_cast<int>(std::min(allowed, static_cast<double>(limit))));
+            }
+        }
+
+        return limit;
+    }
+
+    void record_parse(size_t nreads, size_t nbytes, double seconds) {
+        std::lock_guard<std::mutex> lck(mut);
+        parsed_reads += nreads;
+        parsed_bytes += nbytes;
+        total_parse_time += seconds;
+        smooth(parse_time, parse_reads_timed, nreads, seconds);
+    }
+
+    void record_process(size_t nreads, double seconds) {
+        std::lock_guard<std::mutex> lck(mut);
+        processed_reads += nreads;
+        total_process_time += seconds;
+        smooth(process_time, process_reads_timed, nreads, seconds);
+    }
+
+    // Returns whether processing should continue.
+    bool report(const ProgressCallback& observer, size_t blocks, double reduce_seconds) {
+        Progress current;
+        {
+            std::lock_guard<std::mutex> lck(mut);
+            total_reduce_time += reduce_seconds;
+            if (!observer) {
+                return true;
+            }
+            current.blocks = blocks;
+            current.reads = processed_reads;
+            current.bytes = parsed_bytes;
+            current.parse_time = total_parse_time;
+            current.process_time = total_process_time;
+            current.reduce_time = total_reduce_time;
+        }
+
+        current.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (current.elapsed > 0) {
+            current.reads_per_second = current.reads / current.elapsed;
+        }
+        return observer(current);
+    }
+
+private:
+    BlockSize spec;
+    mutable std::mutex mut;
+    std::chrono::steady_clock::time_point start;
+    size_t parsed_reads = 0, parsed_bytes = 0, processed_reads = 0;
+    double total_parse_time = 0, total_process_time = 0, total_reduce_time = 0;
+    double parse_time = 0, parse_reads_timed = 0;
+    double process_time = 0, process_reads_timed = 0;
+
+    // Exponentially decaying totals, so that the per-read cost responds to
+    // changes in the data without being dominated by a single block.
+    static void smooth(double& time, double& reads, size_t nreads, double seconds) {
+        constexpr double decay = 0.5;
+        time = time * decay + seconds;
+        reads = reads * decay + nreads;
+    }
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
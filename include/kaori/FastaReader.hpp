@@ -0,0 +1,221 @@
+#ifndef KAORI_FASTA_READER_HPP
+#define KAORI_FASTA_READER_HPP
+
+#include "byteme/Reader.hpp"
+#include "find_delimiter.hpp"
+#include "ReadField.hpp"
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/**
+ * @file FastaReader.hpp
+ *
+ * @brief Defines the `FastaReader` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Stream reads from a FASTA file.
+ *
+ * This has the same interface as `FastqReader`, so it can be used in its place in `process_single_end_data()` and `process_paired_end_data()`.
+ * Multi-line sequences are supported.
+ * The name of each read is only considered up to the first whitespace.
+ *
+ * If `views = true` in the constructor, the reader will avoid copying the name and sequence of each read,
+ * see `FastqReader` for details.
+ *
+ * @tparam store_names Whether to extract the name of each read.
+ * If `false`, the header line is skipped with a single scan for the newline and `get_name()` and `get_name_view()` will always be empty.
+ */
+template<bool store_names = true>
+class FastaReader {
+public:
+    /**
+     * @param p Any `byteme::Reader` instance that defines a text stream.
+     * @param views Whether to avoid copying the name and sequence of each read.
+     * If `true`, `get_sequence_view()` and `get_name_view()` should be used to access the current read,
+     * as `get_sequence()` and `get_name()` will need to copy the contents of each field.
+     */
+    FastaReader(byteme::Reader* p, bool views = false) : ptr(p), use_views(views) {
+        sequence.store.reserve(200);
+        if constexpr(store_names) {
+            name.store.reserve(200);
+        }
+
+        refresh();
+        if (available) {
+            if (buffer[0] != '>') {
+                throw std::runtime_error("first line containing FASTA name should start with '>'");
+            }
+            ++avail_pos;
+        }
+    }
+
+    /**
+     * Extract details for the next read in the file.
+     *
+     * @return Whether or not a record was successfully extracted.
+     * If `true`, `get_sequence()` and `get_name()` may be used.
+     * If `false`, this indicates that we reached the end of the file.
+     */
+    bool operator()() {
+        if (available == 0) {
+            return false;
+        }
+
+        name.clear();
+        sequence.clear();
+
+        // Processing the name. If names are not stored, the newline scan
+        // below skips the whole line.
+        while (store_names) {
+            size_t start = avail_pos;
+            avail_pos = find_whitespace(buffer + avail_pos, buffer + available) - buffer;
+            if (avail_pos > start) {
+                name.add(buffer + start, buffer + avail_pos, use_views);
+            }
+            if (avail_pos == available) {
+                refresh<false>();
+                if (!available) {
+                    return true;
+                }
+            } else {
+                break;
+            }
+        }
+
+        // A name without a trailing newline is allowed at the end of the file.
+        while (1) {
+            avail_pos = next_newline();
+            if (avail_pos == available) {
+                refresh<false>();
+                if (!available) {
+                    return true;
+                }
+            } else {
+                ++line_count;
+                ++avail_pos;
+                break;
+            }
+        }
+
+        // Processing the sequence, which continues until the next line
+        // starting with '>' or the end of the file.
+        while (1) {
+            if (avail_pos == available) {
+                refresh<false>();
+                if (!available) {
+                    break;
+                }
+            }
+            if (buffer[avail_pos] == '>') {
+                ++avail_pos; // skipping the marker for the next set of elements.
+                break;
+            }
+
+            while (1) {
+                size_t start = avail_pos;
+                avail_pos = next_newline();
+                if (avail_pos > start) {
+                    sequence.add(buffer + start, buffer + avail_pos, use_views);
+                }
+                if (avail_pos == available) {
+                    refresh<false>();
+                    if (!available) {
+                        return true;
+                    }
+                } else {
+                    ++line_count;
+                    ++avail_pos;
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+    byteme::Reader* ptr;
+    bool use_views;
+    bool source_empty = false;
+
+    const char * buffer;
+    size_t available = 0;
+    size_t avail_pos = 0;
+
+    size_t next_newline() const {
+        return find_newline(buffer + avail_pos, buffer + available) - buffer;
+    }
+
+    template<bool must_work = true>
+    void refresh() {
+        avail_pos = 0;
+
+        if (source_empty) {
+            if (must_work) {
+                throw std::runtime_error("premature end of the file at line " + std::to_string(line_count + 1));
+            } else {
+                available = 0;
+                return;
+            }
+        }
+
+        // The current buffer is about to be invalidated, so any views into
+        // it need to be copied into the fields' own storage.
+        if constexpr(store_names) {
+            name.detach();
+        }
+        sequence.detach();
+
+        source_empty = !(ptr->operator()());
+        buffer = reinterpret_cast<const char*>(ptr->buffer());
+        available = ptr->available();
+    }
+
+private:
+    ReadField sequence;
+    ReadField name;
+    int line_count = 0;
+
+public:
+    /**
+     * @return Vector containing the sequence for the current read.
+     * If `views = true` in the constructor, the sequence is copied from the view on the first call for each read.
+     */
+    const std::vector<char>& get_sequence() const {
+        return sequence.stored();
+    }
+
+    /**
+     * @return Vector containing the name for the current read.
+     * Note that the name is considered to end at the first whitespace on the line.
+     * If `views = true` in the constructor, the name is copied from the view on the first call for each read.
+     */
+    const std::vector<char>& get_name() const {
+        return name.stored();
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the sequence for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_sequence_view() const {
+        return sequence.view();
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the name for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_name_view() const {
+        return name.view();
+    }
+};
+
+}
+
+#endif
@@ -2,14 +2,18 @@
 #define KAORI_FASTQ_READER_HPP
 
 #include "byteme/Reader.hpp"
-#include <cctype>
+#include "find_delimiter.hpp"
+#include "ReadField.hpp"
 #include <vector>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <algorithm>
 
 /**
  * @file FastqReader.hpp
  *
- * @brief Defines the `FastqReader` class.
+ * @brief Defines the `FastqReader` class and related utilities.
  */
 
 namespace kaori {
@@ -20,15 +24,28 @@ namespace kaori {
  * Pretty much what it says on the tin.
  * Multi-line sequence and quality strings are supported.
  * The name of each read is only considered up to the first whitespace.
+ *
+ * If `views = true` in the constructor, the reader will avoid copying the name and sequence of each read.
+ * Instead, `get_sequence_view()` and `get_name_view()` will point directly into the buffer of the `byteme::Reader`.
+ * A copy is only made when a record spans multiple buffers (or, for the sequence, multiple lines).
+ *
+ * @tparam store_names Whether to extract the name of each read.
+ * If `false`, the header line is skipped with a single scan for the newline and `get_name()` and `get_name_view()` will always be empty.
  */
+template<bool store_names = true>
 class FastqReader {
 public:
     /**
      * @param p Any `byteme::Reader` instance that defines a text stream.
+     * @param views Whether to avoid copying the name and sequence of each read.
+     * If `true`, `get_sequence_view()` and `get_name_view()` should be used to access the current read,
+     * as `get_sequence()` and `get_name()` will need to copy the contents of each field.
      */
-    FastqReader(byteme::Reader* p) : ptr(p) {
-        sequence.reserve(200);
-        name.reserve(200);
+    FastqReader(byteme::Reader* p, bool views = false) : ptr(p), use_views(views) {
+        sequence.store.reserve(200);
+        if constexpr(store_names) {
+            name.store.reserve(200);
+        }
 
         refresh();
         if (available) {
@@ -53,11 +70,18 @@ public:
         }
         int init_line = line_count;
 
-        // Processing the name. This should be on a single line, hopefully.
+        // Clearing both fields so that refresh() doesn't try to copy the
+        // now-invalid contents of the previous record.
         name.clear();
-        while (1) {
-            for (; avail_pos < available && !std::isspace(buffer[avail_pos]); ++avail_pos) {
-                name.push_back(buffer[avail_pos]);
+        sequence.clear();
+
+        // Processing the name. This should be on a single line, hopefully.
+        // If names are not stored, the newline scan below skips the whole line.
+        while (store_names) {
+            size_t start = avail_pos;
+            avail_pos = find_whitespace(buffer + avail_pos, buffer + available) - buffer;
+            if (avail_pos > start) {
+                name.add(buffer + start, buffer + avail_pos, use_views);
             }
             if (avail_pos == available) {
                 refresh();
@@ -67,14 +91,8 @@ public:
         }
 
         while (1) {
-            bool finished = false;
-            for (; avail_pos < available; ++avail_pos) {
-                if (buffer[avail_pos] == '\n') {
-                    finished = true;
-                    break;
-                }
-            }
-            if (!finished) {
+            avail_pos = next_newline();
+            if (avail_pos == available) {
                 refresh();
             } else {
                 ++line_count;
@@ -84,10 +102,11 @@ public:
         }
 
         // Processing the sequence itself.
-        sequence.clear();
         while (1) {
-            for (; avail_pos < available && buffer[avail_pos] != '\n'; ++avail_pos) {
-                sequence.push_back(buffer[avail_pos]);
+            size_t start = avail_pos;
+            avail_pos = next_newline();
+            if (avail_pos > start) {
+                sequence.add(buffer + start, buffer + avail_pos, use_views);
             }
             if (avail_pos == available) {
                 refresh();
@@ -108,18 +127,11 @@ public:
         // Line 3 should be a single line. The check above implies that it
         // starts with '+', so no need to check it.
         while (1) {
-            bool finished = false;
-            for (; avail_pos < available; ++avail_pos) {
-                if (buffer[avail_pos] == '\n') {
-                    ++line_count;
-                    finished = true;
-                    break;
-                }
-            }
-            if (!finished) {
+            avail_pos = next_newline();
+            if (avail_pos == available) {
                 refresh();
             } else {
-                ++line_count;
+                line_count += 2;
                 ++avail_pos;
                 break;
             }
@@ -130,9 +142,9 @@ public:
         size_t qual_length = 0;
 
         while (1) {
-            for (; avail_pos < available && buffer[avail_pos] != '\n'; ++avail_pos) {
-                ++qual_length;
-            }
+            size_t start = avail_pos;
+            avail_pos = next_newline();
+            qual_length += avail_pos - start;
             if (avail_pos == available) {
                 refresh<false>();
                 if (!available) {
@@ -165,12 +177,17 @@ public:
 
 private:
     byteme::Reader* ptr;
+    bool use_views;
     bool source_empty = false;
 
     const char * buffer;
     size_t available = 0;
     size_t avail_pos = 0;
 
+    size_t next_newline() const {
+        return find_newline(buffer + avail_pos, buffer + available) - buffer;
+    }
+
     template<bool must_work = true>
     void refresh() {
         avail_pos = 0;
@@ -184,33 +201,137 @@ private:
             }
         }
 
+        // The current buffer is about to be invalidated, so any views into
+        // it need to be copied into the fields' own storage.
+        if constexpr(store_names) {
+            name.detach();
+        }
+        sequence.detach();
+
         source_empty = !(ptr->operator()());
         buffer = reinterpret_cast<const char*>(ptr->buffer());
         available = ptr->available();
     }
 
 private:
-    std::vector<char> sequence;
-    std::vector<char> name;
+    ReadField sequence;
+    ReadField name;
     int line_count = 0;
 
 public:
     /**
      * @return Vector containing the sequence for the current read.
+     * If `views = true` in the constructor, the sequence is copied from the view on the first call for each read.
      */
     const std::vector<char>& get_sequence() const {
-        return sequence;
+        return sequence.stored();
     }
 
     /**
      * @return Vector containing the name for the current read.
      * Note that the name is considered to end at the first whitespace on the line.
+     * If `views = true` in the constructor, the name is copied from the view on the first call for each read.
      */
     const std::vector<char>& get_name() const {
-        return name;
+        return name.stored();
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the sequence for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_sequence_view() const {
+        return sequence.view();
+    }
+
+    /**
+     * @return Pointers to the start and one-past-the-end of the name for the current read.
+     * These are only valid until the next call to `operator()`.
+     */
+    std::pair<const char*, const char*> get_name_view() const {
+        return name.view();
     }
 };
 
+/**
+ * Find the start of the next FASTQ record in an in-memory buffer, starting from an arbitrary position.
+ * This is used to split a buffer into byte ranges that can be parsed independently.
+ *
+ * A record is considered to start at a line beginning with `@`, where the line two positions after it begins with `+`.
+ * This distinguishes the name line from a quality string that happens to start with `@`, as the line two positions after a quality string is the sequence of the next record.
+ * Note that this assumes that each record has its sequence and quality strings on a single line.
+ *
+ * @param[in] buffer Pointer to a buffer containing the contents of a FASTQ file.
+ * @param length Length of the buffer.
+ * @param position Position on the buffer from which to start searching.
+ *
+ * @return Position of the first record that starts at or after `position`.
+ * If `position = 0`, zero is always returned.
+ * If no record could be found, `length` is returned.
+ */
+inline size_t find_next_fastq_record(const char* buffer, size_t length, size_t position) {
+    if (position == 0) {
+        return 0;
+    }
+
+    const char* end = buffer + length;
+    auto next_line = [&](const char* ptr) -> const char* {
+        ptr = find_newline(ptr, end);
+        return (ptr == end ? end : ptr + 1);
+    };
+
+    const char* current = buffer + std::min(position, length);
+    if (current != end && current[-1] != '\n') {
+        current = next_line(current);
+    }
+
+    while (current != end) {
+        if (*current == '@') {
+            auto third = next_line(next_line(current));
+            if (third != end && *third == '+') {
+                return current - buffer;
+            }
+        }
+        current = next_line(current);
+    }
+
+    return length;
+}
+
+/**
+ * Find the byte range of a shard of an in-memory FASTQ file, e.g., from `MappedFile`.
+ * This allows a large file to be split across multiple processes or machines, where each process handles one shard with `process_single_end_buffer()`.
+ * The partial results from each shard can then be combined with the handlers' `write_results()` and `merge_results()` methods.
+ *
+ * The buffer is split into `num_shards` byte ranges of roughly equal size,
+ * and the boundaries of each range are moved forward to the start of the next record with `find_next_fastq_record()`.
+ * Thus, every record is assigned to exactly one shard, i.e., the shard that contains its first byte.
+ *
+ * @param[in] buffer Pointer to a buffer containing the contents of a FASTQ file.
+ * @param length Length of the buffer.
+ * @param shard Index of the shard.
+ * This should be less than `num_shards`.
+ * @param num_shards Total number of shards.
+ *
+ * @return Pair containing the start and one-past-the-end positions of the shard on `buffer`.
+ * This may be an empty range if the shard does not contain the start of any records.
+ */
+inline std::pair<size_t, size_t> find_fastq_shard(const char* buffer, size_t length, size_t shard, size_t num_shards) {
+    if (shard >= num_shards) {
+        throw std::runtime_error("shard index should be less than the number of shards");
+    }
+
+    // Avoiding overflow from computing 'length * shard' directly.
+    size_t base = length / num_shards, remainder = length % num_shards;
+    auto boundary = [&](size_t i) -> size_t {
+        return base * i + std::min(i, remainder);
+    };
+
+    size_t start = find_next_fastq_record(buffer, length, boundary(shard));
+    size_t end = find_next_fastq_record(buffer, length, boundary(shard + 1));
+    return std::make_pair(start, std::max(start, end));
+}
+
 }
 
 #endif
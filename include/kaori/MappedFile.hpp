@@ -0,0 +1,123 @@
+#ifndef KAORI_MAPPED_FILE_HPP
+#define KAORI_MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#if __has_include(<sys/mman.h>)
+#define KAORI_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+/**
+ * @file MappedFile.hpp
+ *
+ * @brief Defines the `MappedFile` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Memory-map an uncompressed file.
+ *
+ * This provides read-only access to the entire contents of a file, typically for use in `process_single_end_buffer()`.
+ * On POSIX systems, the file is memory-mapped so that its contents are only paged in as they are accessed.
+ * On other systems, the entire file is read into memory.
+ */
+class MappedFile {
+public:
+    /**
+     * @param path Path to the file.
+     */
+    MappedFile(const char* path) {
+#ifdef KAORI_USE_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open file at '" + std::string(path) + "'");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("failed to determine the size of '" + std::string(path) + "'");
+        }
+        len = info.st_size;
+
+        // mmap() doesn't like zero-length mappings, so we just skip it.
+        if (len) {
+            void* mapped = ::mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("failed to memory-map '" + std::string(path) + "'");
+            }
+            ::madvise(mapped, len, MADV_SEQUENTIAL);
+            ptr = static_cast<const char*>(mapped);
+        }
+
+        ::close(fd); // the mapping persists after closing.
+#else
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("failed to open file at '" + std::string(path) + "'");
+        }
+        contents.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        ptr = contents.data();
+        len = contents.size();
+#endif
+    }
+
+    /**
+     * @param path Path to the file.
+     */
+    MappedFile(const std::string& path) : MappedFile(path.c_str()) {}
+
+    /**
+     * @cond
+     */
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef KAORI_USE_MMAP
+        if (len) {
+            ::munmap(const_cast<char*>(ptr), len);
+        }
+#endif
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Pointer to the start of the file contents.
+     */
+    const char* data() const {
+        return ptr;
+    }
+
+    /**
+     * @return Size of the file in bytes.
+     */
+    size_t size() const {
+        return len;
+    }
+
+private:
+    const char* ptr = NULL;
+    size_t len = 0;
+#ifndef KAORI_USE_MMAP
+    std::vector<char> contents;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,398 @@
+#ifndef KAORI_PARALLEL_GZIP_READER_HPP
+#define KAORI_PARALLEL_GZIP_READER_HPP
+
+#include "byteme/Reader.hpp"
+#include "zlib.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+/**
+ * @file ParallelGzipReader.hpp
+ *
+ * @brief Defines the `ParallelGzipReader` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Decompress BGZF or Gzip data in parallel.
+ *
+ * This class reads compressed data from a source `byteme::Reader` and presents the decompressed contents through the same `byteme::Reader` interface,
+ * so it can be used directly in `FastqReader`, `process_single_end_data()` or `process_paired_end_data()`.
+ *
+ * For BGZF files (e.g., as produced by `bgzip`), the size of each Gzip member is stored in its header.
+ * This allows us to split the compressed stream into batches of members that are decompressed on separate worker threads.
+ * The decompressed batches are then returned in their original order.
+ *
+ * For other Gzip files, the member sizes are not known until they are decompressed, so parallelization is not possible.
+ * In such cases, we fall back to serial decompression, with support for multiple concatenated members.
+ * This fallback is also used for the remainder of the stream if a non-BGZF member is encountered after some BGZF members.
+ *
+ * Requires linking to Zlib.
+ */
+class ParallelGzipReader : public byteme::Reader {
+public:
+    /**
+     * @param source Any `byteme::Reader` instance that provides the compressed byte stream.
+     * @param num_threads Number of threads to use for decompression.
+     * @param batch_size Number of compressed bytes to decompress in each task.
+     * Larger values reduce synchronization overhead at the cost of memory usage.
+     */
+    ParallelGzipReader(byteme::Reader* source, int num_threads = 1, size_t batch_size = 1000000) :
+        src(source), max_in_flight(2 * num_threads), min_batch(batch_size)
+    {
+        if (num_threads < 1) {
+            throw std::runtime_error("number of threads should be positive");
+        }
+        workers.reserve(num_threads);
+        for (int t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&]() -> void { work(); });
+        }
+    }
+
+    /**
+     * @cond
+     */
+    ParallelGzipReader(const ParallelGzipReader&) = delete;
+    ParallelGzipReader& operator=(const ParallelGzipReader&) = delete;
+
+    ~ParallelGzipReader() {
+        {
+            std::lock_guard<std::mutex> lck(mut);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+        if (serial_init) {
+            inflateEnd(&serial);
+        }
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @cond
+     */
+    bool operator()() {
+        // Skipping batches that decompress to nothing, e.g., the empty BGZF
+        // EOF marker block, so that callers never get an empty buffer while
+        // more input remains.
+        while (1) {
+            bool remaining = next_buffer();
+            if (!remaining || !current.empty()) {
+                return remaining;
+            }
+        }
+    }
+
+    const unsigned char* buffer() const {
+        return current.data();
+    }
+
+    size_t available() const {
+        return current.size();
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    bool next_buffer() {
+        current.clear();
+
+        if (!serial_mode) {
+            submit();
+        }
+
+        // Tasks might still be in flight after switching to serial mode,
+        // so we need to return their results first.
+        if (!tasks.empty()) {
+            auto& front = tasks.front();
+            {
+                std::unique_lock<std::mutex> lck(mut);
+                cv.wait(lck, [&]() -> bool { return front.done; });
+            }
+            if (front.error != "") {
+                throw std::runtime_error(front.error);
+            }
+            current.swap(front.output);
+            tasks.pop_front();
+
+            if (!serial_mode) {
+                submit(); // topping up so that the workers can run while the caller parses 'current'.
+            }
+            return !tasks.empty() || serial_mode || has_input();
+        }
+
+        if (serial_mode && !serial_finished) {
+            inflate_serial();
+            return !serial_finished;
+        }
+
+        return false;
+    }
+
+private:
+    byteme::Reader* src;
+    std::vector<unsigned char> pending;
+    size_t pending_pos = 0;
+    bool src_finished = false;
+
+    std::vector<unsigned char> current;
+
+    bool has_input() const {
+        return pending_pos < pending.size() || !src_finished;
+    }
+
+    // Ensure that at least 'needed' bytes are available in 'pending' after
+    // 'pending_pos'. Returns false if the source is exhausted beforehand.
+    bool fetch(size_t needed) {
+        while (pending.size() - pending_pos < needed) {
+            if (src_finished) {
+                return false;
+            }
+
+            if (pending_pos) {
+                pending.erase(pending.begin(), pending.begin() + pending_pos);
+                pending_pos = 0;
+            }
+
+            src_finished = !(src->operator()());
+            auto ptr = src->buffer();
+            pending.insert(pending.end(), ptr, ptr + src->available());
+        }
+        return true;
+    }
+
+private:
+    struct Task {
+        std::vector<unsigned char> input;
+        std::vector<size_t> block_ends;
+        std::vector<unsigned char> output;
+        bool done = false;
+        std::string error;
+    };
+
+    std::deque<Task> tasks;
+    std::deque<Task*> queue;
+    size_t max_in_flight;
+    size_t min_batch;
+
+    std::vector<std::thread> workers;
+    std::mutex mut;
+    std::condition_variable cv;
+    bool stopped = false;
+
+    // Returns the size of the BGZF block at the current position, zero if
+    // the current member is not in BGZF format, or -1 if the stream is empty.
+    size_t next_block_size() {
+        if (!fetch(1)) {
+            return -1;
+        }
+
+        constexpr size_t fixed = 12;
+        if (!fetch(fixed)) {
+            throw std::runtime_error("incomplete Gzip header in the compressed stream");
+        }
+
+        const unsigned char* header = pending.data() + pending_pos;
+        if (header[0] != 31 || header[1] != 139 || header[2] != 8) {
+            throw std::runtime_error("invalid Gzip header in the compressed stream");
+        }
+        if (!(header[3] & 4)) { // no FEXTRA field, so it can't be BGZF.
+            return 0;
+        }
+
+        size_t xlen = header[10] | (static_cast<size_t>(header[11]) << 8);
+        if (!fetch(fixed + xlen)) {
+            throw std::runtime_error("incomplete Gzip header in the compressed stream");
+        }
+
+        header = pending.data() + pending_pos; // in case it was reallocated.
+        size_t pos = fixed;
+        while (pos + 4 <= fixed + xlen) {
+            size_t slen = header[pos + 2] | (static_cast<size_t>(header[pos + 3]) << 8);
+            if (header[pos] == 'B' && header[pos + 1] == 'C' && slen == 2 && pos + 6 <= fixed + xlen) {
+                return (header[pos + 4] | (static_cast<size_t>(header[pos + 5]) << 8)) + 1;
+            }
+            pos += 4 + slen;
+        }
+
+        return 0;
+    }
+
+    void submit() {
+        while (tasks.size() < max_in_flight && !serial_mode) {
+            Task next;
+
+            while (next.input.size() < min_batch) {
+                size_t block_size = next_block_size();
+                if (block_size == static_cast<size_t>(-1)) {
+                    break;
+                } else if (block_size == 0) {
+                    serial_mode = true;
+                    break;
+                }
+
+                if (!fetch(block_size)) {
+                    throw std::runtime_error("incomplete BGZF block in the compressed stream");
+                }
+                auto start = pending.begin() + pending_pos;
+                next.input.insert(next.input.end(), start, start + block_size);
+                next.block_ends.push_back(next.input.size());
+                pending_pos += block_size;
+            }
+
+            if (next.input.empty()) {
+                break;
+            }
+
+            tasks.push_back(std::move(next));
+            {
+                std::lock_guard<std::mutex> lck(mut);
+                queue.push_back(&(tasks.back())); // deque::push_back doesn't invalidate references.
+            }
+            cv.notify_all();
+        }
+    }
+
+    void work() {
+        while (1) {
+            Task* task;
+            {
+                std::unique_lock<std::mutex> lck(mut);
+                cv.wait(lck, [&]() -> bool { return stopped || !queue.empty(); });
+                if (stopped) {
+                    return;
+                }
+                task = queue.front();
+                queue.pop_front();
+            }
+
+            try {
+                inflate_blocks(*task);
+            } catch (std::exception& e) {
+                task->error = e.what();
+            }
+
+            {
+                std::lock_guard<std::mutex> lck(mut);
+                task->done = true;
+            }
+            cv.notify_all();
+        }
+    }
+
+    static void inflate_blocks(Task& task) {
+        size_t last = 0;
+        for (auto end : task.block_ends) {
+            const unsigned char* block = task.input.data() + last;
+            size_t block_size = end - last;
+            last = end;
+
+            constexpr size_t trailer = 8;
+            size_t header = 12 + (block[10] | (static_cast<size_t>(block[11]) << 8));
+            if (block_size < header + trailer) {
+                throw std::runtime_error("BGZF block is too small");
+            }
+
+            const unsigned char* tail = block + block_size - trailer;
+            uint32_t expected_crc = tail[0] | (static_cast<uint32_t>(tail[1]) << 8) | (static_cast<uint32_t>(tail[2]) << 16) | (static_cast<uint32_t>(tail[3]) << 24);
+            size_t isize = tail[4] | (static_cast<size_t>(tail[5]) << 8) | (static_cast<size_t>(tail[6]) << 16) | (static_cast<size_t>(tail[7]) << 24);
+
+            // Adding an extra byte so that inflate() always has some space to
+            // make progress, even for the empty EOF block.
+            size_t old_size = task.output.size();
+            task.output.resize(old_size + isize + 1);
+
+            z_stream strm;
+            std::memset(&strm, 0, sizeof(z_stream));
+            if (inflateInit2(&strm, -15) != Z_OK) {
+                throw std::runtime_error("failed to initialize the Zlib stream");
+            }
+            strm.next_in = const_cast<unsigned char*>(block + header);
+            strm.avail_in = block_size - header - trailer;
+            strm.next_out = task.output.data() + old_size;
+            strm.avail_out = isize + 1;
+
+            int ret = inflate(&strm, Z_FINISH);
+            size_t produced = (isize + 1) - strm.avail_out;
+            inflateEnd(&strm);
+
+            if (ret != Z_STREAM_END || produced != isize) {
+                throw std::runtime_error("failed to decompress BGZF block");
+            }
+            task.output.resize(old_size + isize);
+            if (crc32(0, task.output.data() + old_size, isize) != expected_crc) {
+                throw std::runtime_error("CRC mismatch in decompressed BGZF block");
+            }
+        }
+    }
+
+private:
+    bool serial_mode = false;
+    bool serial_init = false;
+    bool serial_finished = false;
+    z_stream serial;
+
+    static constexpr size_t serial_chunk = 1000000;
+
+    void inflate_serial() {
+        if (!serial_init) {
+            std::memset(&serial, 0, sizeof(z_stream));
+            if (inflateInit2(&serial, 15 + 32) != Z_OK) { // automatic Gzip header detection.
+                throw std::runtime_error("failed to initialize the Zlib stream");
+            }
+            serial_init = true;
+        }
+
+        current.resize(serial_chunk);
+        serial.next_out = current.data();
+        serial.avail_out = serial_chunk;
+
+        while (serial.avail_out) {
+            if (pending_pos == pending.size()) {
+                if (!fetch(1)) {
+                    break;
+                }
+            }
+
+            serial.next_in = pending.data() + pending_pos;
+            serial.avail_in = pending.size() - pending_pos;
+            int ret = inflate(&serial, Z_NO_FLUSH);
+            pending_pos = pending.size() - serial.avail_in;
+
+            if (ret == Z_STREAM_END) {
+                // Handling concatenated members.
+                if (!fetch(1)) {
+                    serial_finished = true;
+                    break;
+                }
+                inflateReset(&serial);
+            } else if (ret != Z_OK) {
+                throw std::runtime_error("failed to decompress Gzip stream");
+            }
+        }
+
+        current.resize(serial_chunk - serial.avail_out);
+        if (serial.avail_out && !serial_finished) {
+            throw std::runtime_error("incomplete Gzip member at the end of the compressed stream");
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef KAORI_PREFETCH_READER_HPP
+#define KAORI_PREFETCH_READER_HPP
+
+#include "byteme/Reader.hpp"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+
+/**
+ * @file PrefetchReader.hpp
+ *
+ * @brief Defines the `PrefetchReader` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Read ahead from another `byteme::Reader` on a background thread.
+ *
+ * This wraps an existing `byteme::Reader` and calls it from a background thread to fill a ring of buffers.
+ * The caller (typically `FastqReader`) can then parse the current buffer while the next buffers are being filled,
+ * thus overlapping I/O or decompression with parsing.
+ * This is most useful for slow sources, e.g., network-mounted storage or compressed files.
+ *
+ * The wrapped reader should not be used by anyone else during the lifetime of this object.
+ */
+class PrefetchReader : public byteme::Reader {
+public:
+    /**
+     * @param source Any `byteme::Reader` instance.
+     * @param num_buffers Number of buffers in the ring.
+     * This should be at least 2, where 2 corresponds to double-buffering, 3 to triple-buffering, etc.
+     * @param buffer_size Minimum number of bytes to read from `source` into each buffer.
+     * Note that buffers may be larger than this if `source` returns a large chunk.
+     */
+    PrefetchReader(byteme::Reader* source, int num_buffers = 2, size_t buffer_size = 1000000) :
+        src(source), min_size(buffer_size)
+    {
+        if (num_buffers < 2) {
+            throw std::runtime_error("number of buffers should be at least 2");
+        }
+        slots.resize(num_buffers);
+        worker = std::thread([&]() -> void { fill(); });
+    }
+
+    /**
+     * @cond
+     */
+    PrefetchReader(const PrefetchReader&) = delete;
+    PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+    ~PrefetchReader() {
+        {
+            std::lock_guard<std::mutex> lck(mut);
+            stopped = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @cond
+     */
+    bool operator()() {
+        {
+            std::unique_lock<std::mutex> lck(mut);
+
+            // Handing the previous buffer back to the background thread.
+            if (holding) {
+                slots[held].filled = false;
+                holding = false;
+                cv.notify_all();
+            }
+
+            if (finished) {
+                return false;
+            }
+
+            cv.wait(lck, [&]() -> bool { return slots[next].filled; });
+        }
+
+        held = next;
+        holding = true;
+        next = (next + 1) % slots.size();
+
+        const auto& current = slots[held];
+        if (current.error != "") {
+            finished = true;
+            throw std::runtime_error(current.error);
+        }
+        finished = current.last;
+        return !finished;
+    }
+
+    const unsigned char* buffer() const {
+        return (holding ? slots[held].data.data() : NULL);
+    }
+
+    size_t available() const {
+        return (holding ? slots[held].data.size() : 0);
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    byteme::Reader* src;
+    size_t min_size;
+
+    struct Slot {
+        std::vector<unsigned char> data;
+        bool filled = false;
+        bool last = false;
+        std::string error;
+    };
+
+    std::vector<Slot> slots;
+    size_t next = 0, held = 0;
+    bool holding = false;
+    bool finished = false;
+
+    std::thread worker;
+    std::mutex mut;
+    std::condition_variable cv;
+    bool stopped = false;
+
+    void fill() {
+        size_t idx = 0;
+        while (1) {
+            {
+                std::unique_lock<std::mutex> lck(mut);
+                cv.wait(lck, [&]() -> bool { return stopped || !slots[idx].filled; });
+                if (stopped) {
+                    return;
+                }
+            }
+
+            // No need to hold the lock here, as the consumer won't touch this
+            // slot until it is marked as filled.
+            auto& slot = slots[idx];
+            slot.data.clear();
+            bool last = false;
+            try {
+                while (slot.data.size() < min_size) {
+                    last = !(src->operator()());
+                    auto ptr = src->buffer();
+                    slot.data.insert(slot.data.end(), ptr, ptr + src->available());
+                    if (last) {
+                        break;
+                    }
+                }
+            } catch (std::exception& e) {
+                slot.error = e.what();
+                last = true;
+            }
+
+            {
+                std::lock_guard<std::mutex> lck(mut);
+                slot.filled = true;
+                slot.last = last;
+            }
+            cv.notify_all();
+
+            if (last) {
+                return;
+            }
+            idx = (idx + 1) % slots.size();
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef KAORI_PROGRESS_HPP
+#define KAORI_PROGRESS_HPP
+
+#include <functional>
+#include <cstddef>
+
+/**
+ * @file Progress.hpp
+ *
+ * @brief Defines the `Progress` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Progress of a call to `process_single_end_data()` and friends.
+ *
+ * This is passed to a `ProgressCallback` after each block of reads has been processed and reduced.
+ * All timings are in seconds.
+ */
+struct Progress {
+    /**
+     * Number of blocks that have been reduced.
+     */
+    size_t blocks = 0;
+
+    /**
+     * Number of reads (or read pairs, for paired-end data) that have been processed.
+     */
+    size_t reads = 0;
+
+    /**
+     * Number of bytes of sequence (and name) data that have been parsed.
+     * This only counts the parts of each read within the window, so it may be less than the size of the input.
+     */
+    size_t bytes = 0;
+
+    /**
+     * Time elapsed since processing started.
+     */
+    double elapsed = 0;
+
+    /**
+     * Number of reads (or read pairs) processed per second, i.e., `reads / elapsed`.
+     */
+    double reads_per_second = 0;
+
+    /**
+     * Total time spent parsing reads.
+     * For `process_single_end_buffer()`, parsing is performed by the worker threads and is included in `process_time` instead.
+     */
+    double parse_time = 0;
+
+    /**
+     * Total time spent processing reads, summed across all worker threads.
+     */
+    double process_time = 0;
+
+    /**
+     * Total time spent in the handler's `reduce()` (or `flush()`) method.
+     */
+    double reduce_time = 0;
+};
+
+/**
+ * Callback for reporting progress.
+ * This is called in a serial section after each block, so it does not need to be thread-safe.
+ * It should return `true` to continue processing, or `false` to stop early.
+ * If `false`, no further reads are parsed, but any blocks that were already parsed are still processed and reduced.
+ */
+typedef std::function<bool(const Progress&)> ProgressCallback;
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef KAORI_READ_ARRAY_HPP
+#define KAORI_READ_ARRAY_HPP
+
+#include <cstddef>
+#include <utility>
+
+/**
+ * @file ReadArray.hpp
+ *
+ * @brief Defines the `ReadArray` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief View into reads that are already in memory.
+ *
+ * This is used by `process_single_end_reads()` and `process_paired_end_reads()` to avoid serializing in-memory reads into FASTQ text.
+ * It does not own any data, so the arrays (and the sequences/names that they point to) should outlive any call that uses this view.
+ * No copies are made as each read is passed to the handler directly from the supplied pointers.
+ */
+struct ReadArray {
+    /**
+     * Default constructor.
+     */
+    ReadArray() = default;
+
+    /**
+     * @param number Number of reads.
+     * @param sequences Pointer to an array of length `number`, containing pointers to the start of each read sequence.
+     * @param sequence_lengths Pointer to an array of length `number`, containing the length of each read sequence.
+     * @param names Pointer to an array of length `number`, containing pointers to the start of each read name.
+     * This may be `NULL` if the handler does not use names.
+     * @param name_lengths Pointer to an array of length `number`, containing the length of each read name.
+     * This may be `NULL` if the handler does not use names.
+     */
+    ReadArray(size_t number, const char* const* sequences, const size_t* sequence_lengths, const char* const* names = NULL, const size_t* name_lengths = NULL) :
+        number(number), sequences(sequences), sequence_lengths(sequence_lengths), names(names), name_lengths(name_lengths) {}
+
+    /**
+     * Number of reads.
+     */
+    size_t number = 0;
+
+    /**
+     * Pointers to the start of each read sequence.
+     */
+    const char* const* sequences = NULL;
+
+    /**
+     * Length of each read sequence.
+     */
+    const size_t* sequence_lengths = NULL;
+
+    /**
+     * Pointers to the start of each read name, or `NULL` if names are not available.
+     */
+    const char* const* names = NULL;
+
+    /**
+     * Length of each read name, or `NULL` if names are not available.
+     */
+    const size_t* name_lengths = NULL;
+
+    /**
+     * @param i Index of the read.
+     * @return Pointers to the start and one-past-the-end of the sequence of read `i`.
+     */
+    std::pair<const char*, const char*> get_sequence(size_t i) const {
+        return std::make_pair(sequences[i], sequences[i] + sequence_lengths[i]);
+    }
+
+    /**
+     * @param i Index of the read.
+     * @return Pointers to the start and one-past-the-end of the name of read `i`.
+     */
+    std::pair<const char*, const char*> get_name(size_t i) const {
+        return std::make_pair(names[i], names[i] + name_lengths[i]);
+    }
+};
+
+}
+
+#endif
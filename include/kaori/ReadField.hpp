@@ -0,0 +1,78 @@
+#ifndef KAORI_READ_FIELD_HPP
+#define KAORI_READ_FIELD_HPP
+
+#include <vector>
+#include <utility>
+
+/**
+ * @file ReadField.hpp
+ *
+ * @brief Storage for the fields of a sequencing record.
+ */
+
+namespace kaori {
+
+/**
+ * @cond
+ */
+// Holds a field (e.g., name or sequence) of the current record for the
+// various *Reader classes. If views are requested, the field borrows from
+// the reader's buffer and is only copied into its own storage when the
+// field spans multiple segments or the buffer is about to be invalidated.
+struct ReadField {
+    // Mutable so that stored() can copy a borrowed field on request.
+    mutable std::vector<char> store;
+    const char* borrowed_start = NULL;
+    size_t borrowed_length = 0;
+    mutable bool borrowed = false;
+
+    void clear() {
+        store.clear();
+        borrowed = false;
+    }
+
+    void add(const char* start, const char* end, bool views) {
+        if (views && !borrowed && store.empty()) {
+            borrowed_start = start;
+            borrowed_length = end - start;
+            borrowed = true;
+        } else {
+            detach();
+            store.insert(store.end(), start, end);
+        }
+    }
+
+    void detach() const {
+        if (borrowed) {
+            store.insert(store.end(), borrowed_start, borrowed_start + borrowed_length);
+            borrowed = false;
+        }
+    }
+
+    // For the vector accessors of the readers, which must also work with
+    // views. This is logically const as the contents of the field are unchanged.
+    const std::vector<char>& stored() const {
+        detach();
+        return store;
+    }
+
+    size_t size() const {
+        return (borrowed ? borrowed_length : store.size());
+    }
+
+    std::pair<const char*, const char*> view() const {
+        if (borrowed) {
+            return std::make_pair(borrowed_start, borrowed_start + borrowed_length);
+        } else {
+            const char* base = store.data();
+            return std::make_pair(base, base + store.size());
+        }
+    }
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -1,9 +1,17 @@
 #ifndef KAORI_SCAN_TEMPLATE_HPP
 #define KAORI_SCAN_TEMPLATE_HPP
 
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 #include <bitset>
-#include <deque>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include "utils.hpp"
+#include "find_delimiter.hpp"
 
 /**
  * @file ScanTemplate.hpp
@@ -22,18 +30,26 @@ namespace kaori {
  *
  * This class will scan read sequence to find a location that matches the constant regions of the template, give or take any number of substitutions.
  * Multiple locations on the read may match the template, provided `next()` is called repeatedly.
- * For efficiency, the search itself is done after converting all base sequences into a bit encoding.
+ * For efficiency, the search itself is done after converting all base sequences into a 2-bit encoding that is packed into 64-bit words,
+ * with a separate mask to mark ambiguous bases in the read.
+ * The number of mismatches at each position is then computed word-wise with a population count.
  * The maximum size of this encoding is determined at compile-time by the `max_length` template parameter.
+ * Alternatively, if `max_size = 0`, the encoding is sized at run time to the exact number of words required for the template.
+ * This avoids instantiating a separate class (and handlers) for each possible template length, at the cost of a heap-allocated encoding in each `State`.
  *
  * Once a match is found, the sequence of the read at each variable region can be matched against a pool of known barcode sequences.
  * See the `VariableLibrary` class for details.
  *
  * @tparam max_size Maximum length of the template sequence.
+ * If zero, the maximum length is determined at run time from the length of the template.
  */
 template<size_t max_size>
 class ScanTemplate { 
 private:
-    static constexpr size_t N = max_size * 4;
+    // Each base occupies 2 bits, so each word holds 32 bases.
+    static constexpr bool dynamic = (max_size == 0);
+    static constexpr size_t num_words = (max_size * 2 + 63) / 64;
+    typedef typename std::conditional<dynamic, std::vector<uint64_t>, std::array<uint64_t, num_words> >::type Words;
 
 public:
     /**
@@ -47,14 +63,19 @@ public:
      * Constant sequences should only contain `A`, `C`, `G` or `T` (or their lower-case equivalents).
      * Variable regions should be marked with `-`.
      * @param template_length Length of the array pointed to by `template_seq`.
-     * This should be less than or equal to `max_size`.
+     * This should be less than or equal to `max_size`, unless `max_size = 0`.
      * @param search_forward Should the search be performed on the forward strand of the read sequence?
      * @param search_reverse Should the search be performed on the reverse strand of the read sequence?
      */
     ScanTemplate(const char* template_seq, size_t template_length, bool search_forward, bool search_reverse) : 
         length(template_length), forward(search_forward), reverse(search_reverse)
     {
-        if (length > max_size) {
+        if constexpr(dynamic) {
+            size_t nwords = std::max(static_cast<size_t>(1), (length * 2 + 63) / 64);
+            for (auto ptr : { &forward_ref, &forward_mask, &reverse_ref, &reverse_mask }) {
+                ptr->resize(nwords);
+            }
+        } else if (length > max_size) {
             throw std::runtime_error("maximum template size should be " + std::to_string(max_size) + " bp");
         }
 
@@ -62,11 +83,11 @@ public:
             for (size_t i = 0; i < length; ++i) {
                 char b = template_seq[i];
                 if (b != '-') {
-                    add_base(forward_ref, b);
-                    add_mask(forward_mask, i);
+                    push(forward_ref, encode(b));
+                    push(forward_mask, 1);
                 } else {
-                    shift(forward_ref);
-                    shift(forward_mask);
+                    push(forward_ref, 0);
+                    push(forward_mask, 0);
                     add_variable_base(forward_variables, i);
                 }
             }
@@ -84,11 +105,11 @@ public:
             for (size_t i = 0; i < length; ++i) {
                 char b = template_seq[length - i - 1];
                 if (b != '-') {
-                    add_base(reverse_ref, reverse_complement(b));
-                    add_mask(reverse_mask, i);
+                    push(reverse_ref, encode(reverse_complement(b)));
+                    push(reverse_mask, 1);
                 } else {
-                    shift(reverse_ref);
-                    shift(reverse_mask);
+                    push(reverse_ref, 0);
+                    push(reverse_mask, 0);
                     add_variable_base(reverse_variables, i);
                 }
             }
@@ -98,6 +119,9 @@ public:
 public:
     /**
      * @brief Details on the current match to the read sequence.
+     *
+     * Callers that process many reads should keep a `State` in their thread-specific state and re-use it across reads via the `initialize()` overload that accepts an existing `State`.
+     * This avoids re-allocating the encoding for each read when `max_size = 0`.
      */
     struct State {
         /**
@@ -127,10 +151,16 @@ public:
         /**
          * @cond
          */
-        std::bitset<N> state, ambiguous;
+        // The most recent base is stored in the lowest 2 bits of the first word.
+        // Ambiguous bases are stored as 'A' in 'state' and flagged in 'ambiguous'.
+        Words state{}, ambiguous{};
         const char * seq;
         size_t len;
-        std::deque<size_t> bad;
+
+        // Instead of storing the positions of all ambiguous bases, we only
+        // need the last one to know when the window is free of them.
+        bool any_ambiguous = false;
+        size_t last_ambiguous = 0;
         /**
          * @endcond
          */
@@ -148,31 +178,59 @@ public:
      */
     State initialize(const char* read_seq, size_t read_length) const {
         State out;
+        initialize(read_seq, read_length, out);
+        return out;
+    }
+
+    /**
+     * Begin a new search for the template in a read sequence, re-using an existing `State` object.
+     * This is equivalent to the other `initialize()` overload but allows the same object to be re-used across reads.
+     * No memory is allocated by `next()`, nor by this method if `max_size` is positive.
+     * If `max_size = 0`, this method allocates the encoding in `out` when `out` is first used (e.g., a default-constructed `State`) or when it was last used with a shorter template;
+     * subsequent calls with the same `out` and this `ScanTemplate` do not allocate.
+     *
+     * @param[in] read_seq Pointer to an array containing the read sequence.
+     * @param read_length Length of the read sequence.
+     * @param[out] out A `State` object, possibly from a previous search.
+     *
+     * @return `out` is reset to an empty state for `read_seq`, see the other `initialize()` overload for details.
+     */
+    void initialize(const char* read_seq, size_t read_length, State& out) const {
         out.seq = read_seq;
         out.len = read_length;
+        out.position = static_cast<size_t>(-1);
+        out.forward_mismatches = -1;
+        out.reverse_mismatches = -1;
+        out.finished = false;
+        out.any_ambiguous = false;
+        if constexpr(dynamic) {
+            // This only allocates on the first use of 'out'.
+            out.state.resize(forward_ref.size());
+            out.ambiguous.resize(forward_ref.size());
+        }
+        std::fill(out.ambiguous.begin(), out.ambiguous.end(), 0);
 
+        // No need to reset 'out.state', as every base in the window is
+        // replaced before the first mismatch calculation in next().
         if (length <= read_length) {
             for (size_t i = 0; i < length - 1; ++i) {
                 char base = read_seq[i];
 
                 if (is_good(base)) {
-                    add_base(out.state, base);
-                    if (!out.bad.empty()) {
-                        shift(out.ambiguous);
+                    push(out.state, encode(base));
+                    if (out.any_ambiguous) {
+                        push(out.ambiguous, 0);
                     }
                 } else {
-                    shift(out.state);
-                    out.state |= other_<N>;
-                    shift(out.ambiguous);
-                    out.ambiguous |= other_<N>;
-                    out.bad.push_back(i);
+                    push(out.state, 0);
+                    push(out.ambiguous, 1);
+                    out.any_ambiguous = true;
+                    out.last_ambiguous = i;
                 }
             }
         } else {
             out.finished = true;
         }
-
-        return out;
     }
 
     /**
@@ -185,86 +243,340 @@ public:
      * @return `state` is updated with the details of the current match at a particular position on the read sequence.
      */
     void next(State& state) const {
-        if (!state.bad.empty() && state.bad.front() == state.position) {
-            state.bad.pop_front();
-            if (state.bad.empty()) {
-                // This should effectively clear the ambiguous bitset, allowing
-                // us to skip its shifting if there are no more ambiguous
-                // bases. We do it here because we won't get an opportunity to
-                // do it later; as 'bad' is empty, the shift below is skipped.
-                shift(state.ambiguous); 
+        if constexpr(!dynamic) {
+            next_words<num_words>(state);
+        } else {
+            // Dispatching once per position to the same code as the templated
+            // version for short templates. This branch is perfectly predictable.
+            switch (forward_ref.size()) {
+                case 1:
+                    next_words<1>(state);
+                    break;
+                case 2:
+                    next_words<2>(state);
+                    break;
+                default:
+                    next_words<0>(state);
             }
         }
+    }
 
-        size_t right = state.position + length;
-        char base = state.seq[right];
-        if (is_good(base)) {
-            add_base(state.state, base); // no need to trim off the end, the mask will handle that.
-            if (!state.bad.empty()) {
-                shift(state.ambiguous);
-            }
-        } else {
-            shift(state.state);
-            state.state |= other_<N>;
-            shift(state.ambiguous);
-            state.ambiguous |= other_<N>;
-            state.bad.push_back(right);
-        }
+public:
+    /**
+     * @return Whether `scan_batch()` scans several reads side by side for this template.
+     * If `false`, `scan_batch()` is no faster than calling `initialize()` and `next()` on each read.
+     */
+    bool batch_vectorized() const {
+#ifdef KAORI_X86_SIMD
+        // Templates of up to 32 bp fit in the first word, regardless of 'max_size'.
+        return length <= 32 && has_avx2();
+#else
+        return false;
+#endif
+    }
 
-        ++state.position;
-        full_match(state);
-        if (right + 1 == state.len) {
-            state.finished = true;
+    /**
+     * @brief Candidate match from `scan_batch()`.
+     */
+    struct Candidate {
+        /**
+         * Index of the read in the batch.
+         */
+        size_t read;
+
+        /**
+         * Position of the match on the read sequence.
+         */
+        size_t position;
+
+        /**
+         * Number of mismatches on the forward strand, or -1 if the forward strand is not searched.
+         */
+        int forward_mismatches;
+
+        /**
+         * Number of mismatches on the reverse strand, or -1 if the reverse strand is not searched.
+         */
+        int reverse_mismatches;
+    };
+
+    /**
+     * Scan a batch of reads for the template, reporting all positions where the constant regions match on either searched strand.
+     * This is equivalent to calling `initialize()` and `next()` on each read and keeping the positions with no more than `max_mismatches` mismatches,
+     * but allows several reads to be scanned side by side.
+     * On x86 processors with AVX2, templates of up to 32 bp are scanned for 4 reads at a time, with one read in each 64-bit lane;
+     * otherwise, each read is scanned separately.
+     * Vectorization can be disabled by defining the `KAORI_NO_SIMD` macro.
+     *
+     * @param[in] reads Pointer to an array of length `num_reads`, containing pointers to the start and one-past-the-end of each read sequence.
+     * @param num_reads Number of reads in the batch.
+     * @param max_mismatches Maximum number of mismatches for a position to be reported as a candidate.
+     * @param[out] candidates Vector of candidate matches.
+     * New candidates are appended to this vector, ordered by read index and then by position within each read.
+     */
+    void scan_batch(const std::pair<const char*, const char*>* reads, size_t num_reads, int max_mismatches, std::vector<Candidate>& candidates) const {
+#ifdef KAORI_X86_SIMD
+        if (batch_vectorized()) {
+            scan_batch_avx2(reads, num_reads, max_mismatches, candidates);
+            return;
         }
+#endif
 
-        return;
+        State state;
+        for (size_t r = 0; r < num_reads; ++r) {
+            initialize(reads[r].first, reads[r].second - reads[r].first, state);
+            while (!state.finished) {
+                next(state);
+                if ((forward && state.forward_mismatches <= max_mismatches) || (reverse && state.reverse_mismatches <= max_mismatches)) {
+                    candidates.push_back(Candidate{ r, state.position, state.forward_mismatches, state.reverse_mismatches });
+                }
+            }
+        }
     }
 
 private:
-    std::bitset<N> forward_ref, forward_mask;
-    std::bitset<N> reverse_ref, reverse_mask;
+    // The mask has the lower bit set in each 2-bit slot corresponding to a constant base in the template.
+    Words forward_ref{}, forward_mask{};
+    Words reverse_ref{}, reverse_mask{};
     size_t length;
     int mismatches;
     bool forward, reverse;
 
-    static void add_mask(std::bitset<N>& current, size_t pos) {
-        shift(current);
-        current |= other_<N>;
-        for (int i = 0; i < 4; ++i) {
-            current[i] = 1;
+    static uint64_t encode(char b) {
+        switch (b) {
+            case 'A': case 'a':
+                return 0;
+            case 'C': case 'c':
+                return 1;
+            case 'G': case 'g':
+                return 2;
+            case 'T': case 't':
+                return 3;
         }
+        throw std::runtime_error("unknown base '" + std::string(1, b) + "'");
     }
 
-    static int strand_match(const State& match, const std::bitset<N>& ref, const std::bitset<N>& mask) {
-        // pop count here is equal to the number of non-ambiguous mismatches *
-        // 2 + number of ambiguous mismatches * 3. This is because
-        // non-ambiguous bases are encoded by 1 set bit per 4 bases (so 2 are
-        // left after a XOR'd mismatch), while ambiguous mismatches are encoded
-        // by all set bits per 4 bases (which means that 3 are left after XOR).
-        int pcount = ((match.state & mask) ^ ref).count(); 
-
-        // Counting the number of ambiguous bases after masking. Each ambiguous
-        // base is represented by 4 set bits, so we divide by 4 to get the number
-        // of bases; then we multiply by three to remove their contribution. The
-        // difference is then divided by two to get the number of non-ambig mm's.
-        if (!match.bad.empty()) {
-            int acount = (match.ambiguous & mask).count();
-            acount /= 4;
-            return acount + (pcount - acount * 3) / 2;
+    // For all of the *_words() functions, 'fixed' is the number of words if
+    // it is known at compile time, or zero if it is only known at run time.
+    template<size_t fixed>
+    static void push_words(uint64_t* current, size_t nwords, uint64_t code) {
+        if constexpr(fixed == 1) {
+            // Templates up to 32 bp fit in a single word, so the whole window is one shift.
+            current[0] = (current[0] << 2) | code;
+        } else if constexpr(fixed == 2) {
+            // Templates up to 64 bp only need a single carry.
+            current[1] = (current[1] << 2) | (current[0] >> 62);
+            current[0] = (current[0] << 2) | code;
         } else {
-            return pcount / 2;
+            if constexpr(fixed > 0) {
+                nwords = fixed; // allowing the compiler to unroll the loop.
+            }
+            // Shifting from the top so that we don't need a temporary for the carry.
+            for (size_t w = nwords - 1; w > 0; --w) {
+                current[w] = (current[w] << 2) | (current[w - 1] >> 62);
+            }
+            current[0] = (current[0] << 2) | code;
         }
     }
 
+    static void push(Words& current, uint64_t code) {
+        push_words<num_words>(current.data(), current.size(), code);
+    }
+
+    static int popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        return std::bitset<64>(x).count();
+#endif
+    }
+
+    template<size_t fixed>
+    static int match_words(const State& match, const uint64_t* ref, const uint64_t* mask, size_t nwords) {
+        // After XOR'ing, a base is mismatched if either of its 2 bits is set.
+        // These are folded into the lower bit of each slot, which is then
+        // combined with the ambiguity flags so that ambiguous bases are always
+        // counted as mismatches, regardless of their stored code. As the mask
+        // only keeps the lower bit of each constant base, each mismatch
+        // contributes exactly one set bit to the pop count.
+        if constexpr(fixed > 0) {
+            nwords = fixed;
+        }
+
+        const uint64_t* state = match.state.data();
+        int count = 0;
+        if (match.any_ambiguous) {
+            const uint64_t* ambiguous = match.ambiguous.data();
+            for (size_t w = 0; w < nwords; ++w) {
+                uint64_t diff = state[w] ^ ref[w];
+                count += popcount((diff | (diff >> 1) | ambiguous[w]) & mask[w]);
+            }
+        } else {
+            for (size_t w = 0; w < nwords; ++w) {
+                uint64_t diff = state[w] ^ ref[w];
+                count += popcount((diff | (diff >> 1)) & mask[w]);
+            }
+        }
+        return count;
+    }
+
+    template<size_t fixed>
     void full_match(State& match) const {
+        size_t nwords = forward_ref.size();
         if (forward) {
-            match.forward_mismatches = strand_match(match, forward_ref, forward_mask);
+            match.forward_mismatches = match_words<fixed>(match, forward_ref.data(), forward_mask.data(), nwords);
         }
         if (reverse) {
-            match.reverse_mismatches = strand_match(match, reverse_ref, reverse_mask);
+            match.reverse_mismatches = match_words<fixed>(match, reverse_ref.data(), reverse_mask.data(), nwords);
+        }
+    }
+
+    template<size_t fixed>
+    void next_words(State& state) const {
+        if (state.any_ambiguous && state.last_ambiguous == state.position) {
+            // The last ambiguous base is leaving the window, so we clear the
+            // mask, allowing us to skip its shifting until another ambiguous
+            // base is encountered.
+            state.any_ambiguous = false;
+            std::fill(state.ambiguous.begin(), state.ambiguous.end(), 0);
+        }
+
+        size_t nwords = forward_ref.size();
+        size_t right = state.position + length;
+        char base = state.seq[right];
+        if (is_good(base)) {
+            push_words<fixed>(state.state.data(), nwords, encode(base)); // no need to trim off the end, the mask will handle that.
+            if (state.any_ambiguous) {
+                push_words<fixed>(state.ambiguous.data(), nwords, 0);
+            }
+        } else {
+            push_words<fixed>(state.state.data(), nwords, 0);
+            push_words<fixed>(state.ambiguous.data(), nwords, 1);
+            state.any_ambiguous = true;
+            state.last_ambiguous = right;
+        }
+
+        ++state.position;
+        full_match<fixed>(state);
+        if (right + 1 == state.len) {
+            state.finished = true;
         }
     }
 
+#ifdef KAORI_X86_SIMD
+    // Lower 2 bits hold the encoded base, the third bit is set for ambiguous bases.
+    static const std::array<uint8_t, 256>& base_codes() {
+        static const std::array<uint8_t, 256> table = []() {
+            std::array<uint8_t, 256> output;
+            output.fill(4);
+            for (char b : { 'A', 'C', 'G', 'T', 'a', 'c', 'g', 't' }) {
+                output[static_cast<unsigned char>(b)] = encode(b);
+            }
+            return output;
+        }();
+        return table;
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i popcount_avx2(__m256i x) {
+        // No 64-bit pop count in AVX2, so we look up each nibble and sum the bytes in each lane.
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i lower = _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, nibble));
+        __m256i upper = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+        return _mm256_sad_epu8(_mm256_add_epi8(lower, upper), _mm256_setzero_si256());
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i match_avx2(__m256i state, __m256i ambiguous, __m256i ref, __m256i mask) {
+        // Same as match_words(), but with one read in each lane.
+        __m256i diff = _mm256_xor_si256(state, ref);
+        diff = _mm256_or_si256(_mm256_or_si256(diff, _mm256_srli_epi64(diff, 1)), ambiguous);
+        return popcount_avx2(_mm256_and_si256(diff, mask));
+    }
+
+    __attribute__((target("avx2")))
+    void scan_batch_avx2(const std::pair<const char*, const char*>* reads, size_t num_reads, int max_mismatches, std::vector<Candidate>& candidates) const {
+        constexpr size_t lanes = 4;
+        const auto& codes = base_codes();
+        const __m256i fref = _mm256_set1_epi64x(forward_ref[0]), fmask = _mm256_set1_epi64x(forward_mask[0]);
+        const __m256i rref = _mm256_set1_epi64x(reverse_ref[0]), rmask = _mm256_set1_epi64x(reverse_mask[0]);
+        const __m256i limit = _mm256_set1_epi64x(static_cast<int64_t>(max_mismatches) + 1);
+
+        for (size_t start = 0; start < num_reads; start += lanes) {
+            size_t nlanes = std::min(lanes, num_reads - start);
+            std::array<const char*, lanes> seqs{};
+            std::array<size_t, lanes> lens{};
+            size_t longest = 0;
+            for (size_t l = 0; l < nlanes; ++l) {
+                seqs[l] = reads[start + l].first;
+                lens[l] = reads[start + l].second - seqs[l];
+                longest = std::max(longest, lens[l]);
+            }
+            if (longest < length) {
+                continue;
+            }
+
+            // Reads that are shorter than the longest read in the batch are
+            // padded with 'A', and any positions past their end are ignored.
+            // Unlike next(), the ambiguity flags are always shifted, as this
+            // is cheaper than tracking the last ambiguous base in each lane.
+            __m256i state = _mm256_setzero_si256(), ambiguous = _mm256_setzero_si256();
+            __m256i fcount = _mm256_setzero_si256(), rcount = _mm256_setzero_si256();
+            size_t first_candidate = candidates.size();
+
+            for (size_t p = 0; p < longest; ++p) {
+                alignas(32) std::array<uint64_t, lanes> current, flags;
+                for (size_t l = 0; l < lanes; ++l) {
+                    uint8_t code = (p < lens[l] ? codes[static_cast<unsigned char>(seqs[l][p])] : 0);
+                    current[l] = code & 3;
+                    flags[l] = code >> 2;
+                }
+                state = _mm256_or_si256(_mm256_slli_epi64(state, 2), _mm256_load_si256(reinterpret_cast<const __m256i*>(current.data())));
+                ambiguous = _mm256_or_si256(_mm256_slli_epi64(ambiguous, 2), _mm256_load_si256(reinterpret_cast<const __m256i*>(flags.data())));
+                if (p + 1 < length) {
+                    continue;
+                }
+
+                __m256i pass = _mm256_setzero_si256();
+                if (forward) {
+                    fcount = match_avx2(state, ambiguous, fref, fmask);
+                    pass = _mm256_or_si256(pass, _mm256_cmpgt_epi64(limit, fcount));
+                }
+                if (reverse) {
+                    rcount = match_avx2(state, ambiguous, rref, rmask);
+                    pass = _mm256_or_si256(pass, _mm256_cmpgt_epi64(limit, rcount));
+                }
+                if (_mm256_testz_si256(pass, pass)) { // skipping the extraction if no lane has a candidate.
+                    continue;
+                }
+
+                alignas(32) std::array<int64_t, lanes> fvals, rvals, passed;
+                _mm256_store_si256(reinterpret_cast<__m256i*>(fvals.data()), fcount);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(rvals.data()), rcount);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(passed.data()), pass);
+                size_t position = p + 1 - length;
+                for (size_t l = 0; l < nlanes; ++l) {
+                    if (passed[l] && p < lens[l]) {
+                        candidates.push_back(Candidate{
+                            start + l,
+                            position,
+                            (forward ? static_cast<int>(fvals[l]) : -1),
+                            (reverse ? static_cast<int>(rvals[l]) : -1)
+                        });
+                    }
+                }
+            }
+
+            // Candidates are generated by position across all lanes, so we
+            // need to regroup them by read.
+            std::stable_sort(candidates.begin() + first_candidate, candidates.end(), [](const Candidate& left, const Candidate& right) -> bool {
+                return left.read < right.read;
+            });
+        }
+    }
+#endif
+
 private:
     std::vector<std::pair<int, int> > forward_variables, reverse_variables;
 
@@ -0,0 +1,119 @@
+#ifndef KAORI_SEARCH_STATS_HPP
+#define KAORI_SEARCH_STATS_HPP
+
+#include <cstdint>
+#include <chrono>
+
+/**
+ * @file SearchStats.hpp
+ *
+ * @brief Defines the `SearchStats` class.
+ */
+
+/**
+ * @cond
+ */
+#ifdef KAORI_INSTRUMENT
+#define KAORI_COUNT(state, field) ++((state).stats.field)
+#define KAORI_TIME(state, field) ::kaori::SearchTimer kaori_search_timer_((state).stats.field)
+#else
+#define KAORI_COUNT(state, field)
+#define KAORI_TIME(state, field)
+#endif
+/**
+ * @endcond
+ */
+
+namespace kaori {
+
+/**
+ * @brief Counters and timings for the barcode searches.
+ *
+ * These statistics are only collected if `KAORI_INSTRUMENT` is defined before including any **kaori** headers.
+ * Otherwise, no counting is performed and there is no run-time cost.
+ * When enabled, the statistics for each handler can be retrieved with its `get_stats()` method after processing.
+ *
+ * Note that `KAORI_INSTRUMENT` changes the layout of the search classes, so it should be defined consistently across all translation units.
+ */
+struct SearchStats {
+    /**
+     * Number of searches for a variable region, i.e., the number of times that the template was matched to a read and its variable region was looked up.
+     */
+    uint64_t searches = 0;
+
+    /**
+     * Number of searches that were resolved by an exact match to a known barcode.
+     */
+    uint64_t exact_hits = 0;
+
+    /**
+     * Number of searches that were resolved from the mismatch cache, either in the thread-specific state or in the shared cache.
+     */
+    uint64_t cache_hits = 0;
+
+    /**
+     * Number of searches that required a traversal of the mismatch trie.
+     */
+    uint64_t trie_searches = 0;
+
+    /**
+     * Time spent scanning reads for the template sequence, accumulated across all threads.
+     * This is measured for each read rather than for each position of the template on the read, as the latter would cost more than the scan itself.
+     * Thus, it also includes the time spent searching for the variable regions at each candidate position, i.e., it is an upper bound on the time spent in `ScanTemplate`.
+     */
+    std::chrono::nanoseconds scan_time{0};
+
+    /**
+     * Time spent on the searches that required a traversal of the mismatch trie, accumulated across all threads.
+     * For searches performed while scanning a read, this is also included in `scan_time`.
+     */
+    std::chrono::nanoseconds trie_time{0};
+
+    /**
+     * @param other Another set of statistics.
+     * @return Counters and timings in `other` are added to this instance.
+     */
+    SearchStats& operator+=(const SearchStats& other) {
+        searches += other.searches;
+        exact_hits += other.exact_hits;
+        cache_hits += other.cache_hits;
+        trie_searches += other.trie_searches;
+        scan_time += other.scan_time;
+        trie_time += other.trie_time;
+        return *this;
+    }
+
+    /**
+     * @return Proportion of non-exact searches that were resolved from the cache.
+     */
+    double cache_hit_rate() const {
+        auto inexact = cache_hits + trie_searches;
+        return inexact ? static_cast<double>(cache_hits) / inexact : 0;
+    }
+};
+
+/**
+ * @cond
+ */
+class SearchTimer {
+public:
+    SearchTimer(std::chrono::nanoseconds& target) : target(target), start(std::chrono::steady_clock::now()) {}
+
+    ~SearchTimer() {
+        target += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    SearchTimer(const SearchTimer&) = delete;
+    SearchTimer& operator=(const SearchTimer&) = delete;
+
+private:
+    std::chrono::nanoseconds& target;
+    std::chrono::steady_clock::time_point start;
+};
+/**
+ * @endcond
+ */
+
+}
+
+#endif
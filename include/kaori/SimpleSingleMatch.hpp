@@ -26,6 +26,7 @@ namespace kaori {
  * No restrictions are placed on the distribution of mismatches throughout the target sequence.
  * 
  * @tparam max_size Maximum length of the template sequence.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
  */
 template<size_t max_size>
 class SimpleSingleMatch {
@@ -105,6 +106,13 @@ public:
          * @cond
          */
         typename SimpleBarcodeSearch::State forward_details, reverse_details;
+
+        typename ScanTemplate<max_size>::State scan;
+        std::vector<typename ScanTemplate<max_size>::Candidate> candidates;
+        std::string buffer;
+#ifdef KAORI_INSTRUMENT
+        SearchStats stats;
+#endif
         /**
          * @endcond
          */
@@ -135,25 +143,127 @@ public:
         if (reverse) {
             reverse_lib.reduce(state.reverse_details);
         }
+#ifdef KAORI_INSTRUMENT
+        stats += state.stats;
+        state.stats = SearchStats();
+#endif
+    }
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        SearchStats output = stats;
+        if (forward) {
+            output += forward_lib.get_stats();
+        }
+        if (reverse) {
+            output += reverse_lib.get_stats();
+        }
+        return output;
     }
+#endif
 
 private:
     bool has_match(int obs_mismatches) const {
         return (obs_mismatches >= 0 && obs_mismatches <= max_mm);
     }
 
-    void forward_match(const char* seq, const typename ScanTemplate<max_size>::State& details, State& state) const {
-        auto start = seq + details.position;
+    void forward_match(const char* seq, size_t position, int const_mismatches, State& state) const {
+        auto start = seq + position;
         const auto& range = constant.variable_regions()[0];
-        std::string curseq(start + range.first, start + range.second);
-        forward_lib.search(curseq, state.forward_details, max_mm - details.forward_mismatches);
+        state.buffer.assign(start + range.first, start + range.second);
+        forward_lib.search(state.buffer, state.forward_details, max_mm - const_mismatches);
     }
 
-    void reverse_match(const char* seq, const typename ScanTemplate<max_size>::State& details, State& state) const {
-        auto start = seq + details.position;
+    void reverse_match(const char* seq, size_t position, int const_mismatches, State& state) const {
+        auto start = seq + position;
         const auto& range = constant.template variable_regions<true>()[0];
-        std::string curseq(start + range.first, start + range.second);
-        reverse_lib.search(curseq, state.reverse_details, max_mm - details.reverse_mismatches);
+        state.buffer.assign(start + range.first, start + range.second);
+        reverse_lib.search(state.buffer, state.reverse_details, max_mm - const_mismatches);
+    }
+
+    static void reset(State& state) {
+        state.index = -1;
+        state.mismatches = 0;
+        state.variable_mismatches = 0;
+    }
+
+    bool update_first(size_t position, bool rev, int const_mismatches, const typename SimpleBarcodeSearch::State& x, State& state) const {
+        if (x.index < 0) {
+            return false;
+        }
+
+        int total = const_mismatches + x.mismatches;
+        if (total > max_mm) {
+            return false;
+        }
+
+        state.position = position;
+        state.mismatches = total;
+        state.reverse = rev;
+        state.index = x.index;
+        state.variable_mismatches = x.mismatches;
+        return true;
+    }
+
+    // Returns whether a match was found at this position, in which case the search can stop.
+    bool check_first(const char* seq, size_t position, int forward_mismatches, int reverse_mismatches, State& state) const {
+        if (forward && has_match(forward_mismatches)) {
+            forward_match(seq, position, forward_mismatches, state);
+            if (update_first(position, false, forward_mismatches, state.forward_details, state)) {
+                return true;
+            }
+        }
+
+        if (reverse && has_match(reverse_mismatches)) {
+            reverse_match(seq, position, reverse_mismatches, state);
+            if (update_first(position, true, reverse_mismatches, state.reverse_details, state)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void update_best(size_t position, bool rev, int const_mismatches, const typename SimpleBarcodeSearch::State& x, State& state, int& best, bool& found) const {
+        if (x.index < 0) {
+            return;
+        }
+
+        auto total = x.mismatches + const_mismatches;
+        if (total == best) { 
+            if (state.index != x.index) { // ambiguous, setting back to a mismatch.
+                found = false;
+                state.index = -1;
+            }
+        } else if (total < best) {
+            found = true;
+            best = total; 
+            // A further optimization at this point would be to narrow
+            // max_mm to the current 'best'. But this probably
+            // isn't worth it.
+
+            state.index = x.index;
+            state.mismatches = total;
+            state.variable_mismatches = x.mismatches;
+            state.position = position;
+            state.reverse = rev;
+        }
+    }
+
+    void check_best(const char* seq, size_t position, int forward_mismatches, int reverse_mismatches, State& state, int& best, bool& found) const {
+        if (forward && has_match(forward_mismatches)) {
+            forward_match(seq, position, forward_mismatches, state);
+            update_best(position, false, forward_mismatches, state.forward_details, state, best, found);
+        }
+
+        if (reverse && has_match(reverse_mismatches)) {
+            reverse_match(seq, position, reverse_mismatches, state);
+            update_best(position, true, reverse_mismatches, state.reverse_details, state, best, found);
+        }
     }
 
 public:
@@ -170,50 +280,19 @@ public:
      * If `true`, `state` is filled with the details of the first match.
      */
     bool search_first(const char* read_seq, size_t read_length, State& state) const {
-        auto deets = constant.initialize(read_seq, read_length);
-        bool found = false;
-        state.index = -1;
-        state.mismatches = 0;
-        state.variable_mismatches = 0;
-
-        auto update = [&](bool rev, int const_mismatches, const typename SimpleBarcodeSearch::State& x) -> bool {
-            if (x.index < 0) {
-                return false;
-            }
-
-            int total = const_mismatches + x.mismatches;
-            if (total > max_mm) {
-                return false;
-            }
-
-            found = true;
-            state.position = deets.position;
-            state.mismatches = total;
-            state.reverse = rev;
-            state.index = x.index;
-            state.variable_mismatches = x.mismatches;
-            return true;
-        };
+        KAORI_TIME(state, scan_time);
+        auto& deets = state.scan;
+        constant.initialize(read_seq, read_length, deets);
+        reset(state);
 
         while (!deets.finished) {
             constant.next(deets);
-
-            if (forward && has_match(deets.forward_mismatches)) {
-                forward_match(read_seq, deets, state);
-                if (update(false, deets.forward_mismatches, state.forward_details)) {
-                    break;
-                }
-            }
-
-            if (reverse && has_match(deets.reverse_mismatches)) {
-                reverse_match(read_seq, deets, state);
-                if (update(true, deets.reverse_mismatches, state.reverse_details)) {
-                    break;
-                }
+            if (check_first(read_seq, deets.position, deets.forward_mismatches, deets.reverse_mismatches, state)) {
+                return true;
             }
         }
 
-        return found;
+        return false;
     }
 
     /**
@@ -229,52 +308,81 @@ public:
      * If `true`, `state` is filled with the details of the best match.
      */
     bool search_best(const char* read_seq, size_t read_length, State& state) const {
-        auto deets = constant.initialize(read_seq, read_length);
+        KAORI_TIME(state, scan_time);
+        auto& deets = state.scan;
+        constant.initialize(read_seq, read_length, deets);
         state.index = -1;
         bool found = false;
         int best = max_mm + 1;
 
-        auto update = [&](bool rev,  int const_mismatches, const typename SimpleBarcodeSearch::State& x) -> void {
-            if (x.index < 0) {
-                return;
-            }
-
-            auto total = x.mismatches + const_mismatches;
-            if (total == best) { 
-                if (state.index != x.index) { // ambiguous, setting back to a mismatch.
-                    found = false;
-                    state.index = -1;
-                }
-            } else if (total < best) {
-                found = true;
-                best = total; 
-                // A further optimization at this point would be to narrow
-                // max_mm to the current 'best'. But this probably
-                // isn't worth it.
-
-                state.index = x.index;
-                state.mismatches = total;
-                state.variable_mismatches = x.mismatches;
-                state.position = deets.position;
-                state.reverse = rev;
-            }
-        };
-
         while (!deets.finished) {
             constant.next(deets);
+            check_best(read_seq, deets.position, deets.forward_mismatches, deets.reverse_mismatches, state, best, found);
+        }
 
-            if (forward && has_match(deets.forward_mismatches)) {
-                forward_match(read_seq, deets, state);
-                update(false, deets.forward_mismatches, state.forward_details);
-            }
+        return found;
+    }
 
-            if (reverse && has_match(deets.reverse_mismatches)) {
-                reverse_match(read_seq, deets, state);
-                update(true, deets.reverse_mismatches, state.reverse_details);
+    /**
+     * Search a batch of reads, equivalent to calling `search_first()` or `search_best()` on each read in turn.
+     * If `ScanTemplate::batch_vectorized()` is `true` for the template, the constant regions of several reads are scanned side by side with `ScanTemplate::scan_batch()`;
+     * otherwise, this just calls `search_first()` or `search_best()` on each read.
+     *
+     * @tparam Function Function to be called on the results for each read.
+     *
+     * @param[in] reads Pointer to an array of length `num_reads`, containing pointers to the start and one-past-the-end of each read sequence.
+     * @param num_reads Number of reads in the batch.
+     * @param use_first Whether to search for the first match with `search_first()`, or the best match with `search_best()`.
+     * @param state State object, used to store the search result for each read.
+     * @param fun Function that accepts the index of the read in the batch and a boolean indicating whether a match was found (i.e., the return value of `search_first()` or `search_best()`).
+     * This is called once for each read in order, and may inspect `state` for the details of the match.
+     */
+    template<class Function>
+    void search_batch(const std::pair<const char*, const char*>* reads, size_t num_reads, bool use_first, State& state, Function fun) const {
+        if (!constant.batch_vectorized()) {
+            for (size_t r = 0; r < num_reads; ++r) {
+                const auto& x = reads[r];
+                fun(r, use_first ? search_first(x.first, x.second - x.first, state) : search_best(x.first, x.second - x.first, state));
             }
+            return;
         }
 
-        return found;
+        KAORI_TIME(state, scan_time);
+        auto& candidates = state.candidates;
+        candidates.clear();
+        constant.scan_batch(reads, num_reads, max_mm, candidates);
+
+        // Candidates are ordered by read and then by position, so we just
+        // walk through them in the same order as search_first() or search_best().
+        size_t c = 0, num_candidates = candidates.size();
+        for (size_t r = 0; r < num_reads; ++r) {
+            const char* seq = reads[r].first;
+            bool found = false;
+
+            if (use_first) {
+                reset(state);
+                for (; c < num_candidates && candidates[c].read == r; ++c) {
+                    const auto& current = candidates[c];
+                    if (check_first(seq, current.position, current.forward_mismatches, current.reverse_mismatches, state)) {
+                        found = true;
+                        break;
+                    }
+                }
+            } else {
+                state.index = -1;
+                int best = max_mm + 1;
+                for (; c < num_candidates && candidates[c].read == r; ++c) {
+                    const auto& current = candidates[c];
+                    check_best(seq, current.position, current.forward_mismatches, current.reverse_mismatches, state, best, found);
+                }
+            }
+
+            // Skipping the remaining candidates for this read after an early exit.
+            while (c < num_candidates && candidates[c].read == r) {
+                ++c;
+            }
+            fun(r, found);
+        }
     }
 
 private:
@@ -284,6 +392,9 @@ private:
 
     ScanTemplate<max_size> constant;
     SimpleBarcodeSearch forward_lib, reverse_lib;
+#ifdef KAORI_INSTRUMENT
+    SearchStats stats;
+#endif
 };
 
 }
@@ -0,0 +1,139 @@
+#ifndef KAORI_SPARSE_COUNTS_HPP
+#define KAORI_SPARSE_COUNTS_HPP
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @file SparseCounts.hpp
+ *
+ * @brief Defines the `SparseCounts` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Sparse counts for a thread-specific state.
+ *
+ * This stores the count for each barcode that was touched since the last transfer, as pairs of barcode indices and counts.
+ * Handlers use it in their thread-specific states instead of a dense vector of counts,
+ * so that merging a block is proportional to the number of distinct barcodes in that block rather than the size of the barcode pool.
+ * Barcode indices are looked up in a small open-addressing hash table that is sized to the number of distinct barcodes touched since the last transfer,
+ * so the memory usage of each state scales with the number of distinct barcodes in a block rather than with the size of the pool.
+ * The table is re-used across transfers, so no allocations are performed once the state has warmed up.
+ *
+ * @tparam Count Integer type for the counts.
+ */
+template<typename Count>
+class SparseCounts {
+public:
+    /**
+     * @param index Index of the barcode.
+     * Its count is incremented by 1.
+     */
+    void add(int index) {
+        if ((touched.size() + 1) * 2 > table.size()) {
+            rehash(std::max<size_t>(16, table.size() * 2));
+        }
+
+        size_t mask = table.size() - 1;
+        size_t h = hash(index) & mask;
+        while (1) {
+            auto& slot = table[h];
+            if (slot < 0) {
+                slot = touched.size();
+                touched.emplace_back(index, 1);
+                return;
+            }
+            auto& current = touched[slot];
+            if (current.first == index) {
+                ++(current.second);
+                return;
+            }
+            h = (h + 1) & mask;
+        }
+    }
+
+    /**
+     * @param index Index of the barcode.
+     * @return Count for the barcode since the last call to `transfer()`.
+     */
+    Count count(int index) const {
+        if (table.empty()) {
+            return 0;
+        }
+
+        size_t mask = table.size() - 1;
+        size_t h = hash(index) & mask;
+        while (1) {
+            auto slot = table[h];
+            if (slot < 0) {
+                return 0;
+            }
+            const auto& current = touched[slot];
+            if (current.first == index) {
+                return current.second;
+            }
+            h = (h + 1) & mask;
+        }
+    }
+
+    /**
+     * @return Whether no barcodes have been touched since the last call to `transfer()`.
+     */
+    bool empty() const {
+        return touched.empty();
+    }
+
+    /**
+     * @return Number of distinct barcodes touched since the last call to `transfer()`.
+     */
+    size_t size() const {
+        return touched.size();
+    }
+
+    /**
+     * Add the counts to a dense vector and reset this object.
+     *
+     * @tparam Output Integer type for the dense counts.
+     * @param[out] output Vector of counts for all barcodes.
+     * This should be at least as long as the largest index passed to `add()`.
+     */
+    template<typename Output>
+    void transfer(std::vector<Output>& output) {
+        for (const auto& t : touched) {
+            output[t.first] += t.second;
+        }
+        touched.clear();
+        std::fill(table.begin(), table.end(), -1);
+    }
+
+private:
+    std::vector<int> table;
+    std::vector<std::pair<int, Count> > touched;
+
+    static size_t hash(int index) {
+        // Fibonacci hashing to spread out consecutive indices.
+        return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(index)) * 11400714819323198485ull) >> 32);
+    }
+
+    void rehash(size_t capacity) {
+        table.clear();
+        table.resize(capacity, -1);
+        size_t mask = capacity - 1;
+        for (size_t i = 0, end = touched.size(); i < end; ++i) {
+            size_t h = hash(touched[i].first) & mask;
+            while (table[h] >= 0) {
+                h = (h + 1) & mask;
+            }
+            table[h] = i;
+        }
+    }
+};
+
+}
+
+#endif
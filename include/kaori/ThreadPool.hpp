@@ -0,0 +1,132 @@
+#ifndef KAORI_THREAD_POOL_HPP
+#define KAORI_THREAD_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @file ThreadPool.hpp
+ *
+ * @brief Defines the `ThreadPool` class.
+ */
+
+namespace kaori {
+
+/**
+ * @brief Persistent pool of worker threads.
+ *
+ * Workers are started once on construction and then pull tasks from a shared queue until the pool is destroyed.
+ * This avoids the cost of creating and joining a new thread for each block of reads in `process_single_end_data()` and friends.
+ * A single pool can also be shared across multiple calls to those functions, e.g., when processing many files in succession.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param num_threads Number of worker threads.
+     */
+    ThreadPool(int num_threads = 1) {
+        if (num_threads < 1) {
+            throw std::runtime_error("number of threads should be positive");
+        }
+        workers.reserve(num_threads);
+        for (int t = 0; t < num_threads; ++t) {
+            workers.emplace_back([this, t]() -> void { work(t); });
+        }
+    }
+
+    /**
+     * @cond
+     */
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lck(mut);
+            stopped = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) {
+            w.join();
+        }
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Number of worker threads.
+     */
+    int size() const {
+        return workers.size();
+    }
+
+    /**
+     * @return Index of the worker thread that is running the current task, from 0 to `size() - 1`.
+     * As each worker only runs one task at a time, this can be used by tasks to access per-worker data without locking.
+     * If the caller is not one of the workers in this pool, -1 is returned.
+     */
+    int worker_index() const {
+        const auto& current = current_worker();
+        return (current.first == this ? current.second : -1);
+    }
+
+    /**
+     * @tparam Function A callable that accepts no arguments.
+     * @param fun Function to be executed on one of the worker threads.
+     *
+     * @return A future that is ready when `fun` has completed.
+     * Any exception thrown by `fun` is rethrown by the future's `get()` method.
+     */
+    template<class Function>
+    std::future<void> submit(Function fun) {
+        std::packaged_task<void()> task(std::move(fun));
+        auto output = task.get_future();
+        {
+            std::lock_guard<std::mutex> lck(mut);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+        return output;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()> > tasks;
+    std::mutex mut;
+    std::condition_variable cv;
+    bool stopped = false;
+
+    static std::pair<const ThreadPool*, int>& current_worker() {
+        thread_local std::pair<const ThreadPool*, int> current(NULL, -1);
+        return current;
+    }
+
+    void work(int index) {
+        current_worker() = std::make_pair(this, index);
+        while (1) {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lck(mut);
+                cv.wait(lck, [&]() -> bool { return stopped || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+}
+
+#endif
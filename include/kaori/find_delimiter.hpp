@@ -0,0 +1,159 @@
+#ifndef KAORI_FIND_DELIMITER_HPP
+#define KAORI_FIND_DELIMITER_HPP
+
+#if !defined(KAORI_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define KAORI_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/**
+ * @file find_delimiter.hpp
+ *
+ * @brief Find delimiting characters in a text buffer.
+ */
+
+namespace kaori {
+
+/**
+ * @cond
+ */
+inline bool is_whitespace(char c) {
+    // Same as std::isspace() in the default "C" locale.
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline const char* find_newline_scalar(const char* start, const char* end) {
+    for (; start < end && *start != '\n'; ++start) {}
+    return start;
+}
+
+inline const char* find_whitespace_scalar(const char* start, const char* end) {
+    for (; start < end && !is_whitespace(*start); ++start) {}
+    return start;
+}
+
+#ifdef KAORI_X86_SIMD
+inline const char* find_newline_sse2(const char* start, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - start >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(start));
+        int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (hits) {
+            return start + __builtin_ctz(hits);
+        }
+        start += 16;
+    }
+    return find_newline_scalar(start, end);
+}
+
+inline const char* find_whitespace_sse2(const char* start, const char* end) {
+    // Whitespace is either a space or any character in [\t, \r]. The latter
+    // is detected by checking that (c - '\t') saturates to zero after
+    // subtracting the width of the range, i.e., it's an unsigned <= 4.
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i first = _mm_set1_epi8('\t');
+    const __m128i width = _mm_set1_epi8('\r' - '\t');
+    const __m128i zero = _mm_setzero_si128();
+    while (end - start >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(start));
+        __m128i in_range = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(block, first), width), zero);
+        int hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, space), in_range));
+        if (hits) {
+            return start + __builtin_ctz(hits);
+        }
+        start += 16;
+    }
+    return find_whitespace_scalar(start, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* find_newline_avx2(const char* start, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - start >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start));
+        unsigned int hits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+        if (hits) {
+            return start + __builtin_ctz(hits);
+        }
+        start += 32;
+    }
+    return find_newline_sse2(start, end);
+}
+
+__attribute__((target("avx2")))
+inline const char* find_whitespace_avx2(const char* start, const char* end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i first = _mm256_set1_epi8('\t');
+    const __m256i width = _mm256_set1_epi8('\r' - '\t');
+    const __m256i zero = _mm256_setzero_si256();
+    while (end - start >= 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start));
+        __m256i in_range = _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(block, first), width), zero);
+        unsigned int hits = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), in_range));
+        if (hits) {
+            return start + __builtin_ctz(hits);
+        }
+        start += 32;
+    }
+    return find_whitespace_sse2(start, end);
+}
+
+inline bool has_avx2() {
+    static const bool available = __builtin_cpu_supports("avx2");
+    return available;
+}
+#endif
+/**
+ * @endcond
+ */
+
+/**
+ * Find the first newline in a character buffer.
+ * On x86 processors, this uses AVX2 or SSE2 instructions (chosen at run time) to scan the buffer a block at a time;
+ * otherwise, it falls back to a scalar loop.
+ * Vectorization can be disabled by defining the `KAORI_NO_SIMD` macro.
+ *
+ * @param[in] start Pointer to the start of the buffer.
+ * @param[in] end Pointer to one-past-the-end of the buffer.
+ *
+ * @return Pointer to the first newline in `[start, end)`, or `end` if no newline is present.
+ */
+inline const char* find_newline(const char* start, const char* end) {
+#ifdef KAORI_X86_SIMD
+    if (has_avx2()) {
+        return find_newline_avx2(start, end);
+    } else {
+        return find_newline_sse2(start, end);
+    }
+#else
+    return find_newline_scalar(start, end);
+#endif
+}
+
+/**
+ * Find the first whitespace character in a character buffer.
+ * Whitespace is defined as in `std::isspace()` for the default locale, i.e., spaces, tabs, newlines, vertical tabs, form feeds and carriage returns.
+ * On x86 processors, this uses AVX2 or SSE2 instructions (chosen at run time) to scan the buffer a block at a time;
+ * otherwise, it falls back to a scalar loop.
+ * Vectorization can be disabled by defining the `KAORI_NO_SIMD` macro.
+ *
+ * @param[in] start Pointer to the start of the buffer.
+ * @param[in] end Pointer to one-past-the-end of the buffer.
+ *
+ * @return Pointer to the first whitespace character in `[start, end)`, or `end` if no whitespace is present.
+ */
+inline const char* find_whitespace(const char* start, const char* end) {
+#ifdef KAORI_X86_SIMD
+    if (has_avx2()) {
+        return find_whitespace_avx2(start, end);
+    } else {
+        return find_whitespace_sse2(start, end);
+    }
+#else
+    return find_whitespace_scalar(start, end);
+#endif
+}
+
+}
+
+#endif
@@ -3,9 +3,11 @@
 
 #include "../SimpleSingleMatch.hpp"
 #include "../utils.hpp"
+#include "../serialize.hpp"
 
 #include <array>
 #include <vector>
+#include <cstdint>
 
 /**
  * @file CombinatorialBarcodesPairedEnd.hpp
@@ -24,8 +26,11 @@ namespace kaori {
  * This handler will capture the frequencies of each barcode combination. 
  *
  * @tparam max_size Maximum length of the template sequences on both reads.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size>
+template<size_t max_size, typename Count = uint64_t>
 class CombinatorialBarcodesPairedEnd { 
 public:
     /**
@@ -83,9 +88,9 @@ public:
         State(typename SimpleSingleMatch<max_size>::State s1, typename SimpleSingleMatch<max_size>::State s2) : search1(std::move(s1)), search2(std::move(s2)) {}
 
         std::vector<std::array<int, 2> >collected;
-        int barcode1_only = 0;
-        int barcode2_only = 0;
-        int total = 0;
+        Count barcode1_only = 0;
+        Count barcode2_only = 0;
+        Count total = 0;
 
         /**
          * @cond
@@ -105,9 +110,13 @@ public:
         matcher1.reduce(s.search1);
         matcher2.reduce(s.search2);
         combinations.insert(combinations.end(), s.collected.begin(), s.collected.end());
+        s.collected.clear();
         total += s.total;
+        s.total = 0;
         barcode1_only += s.barcode1_only;
+        s.barcode1_only = 0;
         barcode2_only += s.barcode2_only;
+        s.barcode2_only = 0;
     }
 
     constexpr static bool use_names = false;
@@ -219,21 +228,74 @@ public:
     /**
      * @return Total number of read pairs processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return total;
     }
 
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        write_results_header(out, "CombinatorialBarcodesPairedEnd");
+        write_results_combinations(out, combinations);
+        write_results_value(out, total);
+        write_results_value(out, barcode1_only);
+        write_results_value(out, barcode2_only);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The combinations in `in` are appended to those of this instance, and the totals are added together.
+     * `sort()` may be called after all results have been merged.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        add_results(parse_results(in));
+    }
+
+    /**
+     * @cond
+     */
+    ParsedCombinations<2, Count, 3> parse_results(std::istream& in) const {
+        return read_results_parsed_combinations<2, Count, 3>(in, "CombinatorialBarcodesPairedEnd");
+    }
+
+    void add_results(const ParsedCombinations<2, Count, 3>& parsed) {
+        parsed.add_to(combinations);
+        total += parsed.totals[0];
+        barcode1_only += parsed.totals[1];
+        barcode2_only += parsed.totals[2];
+    }
+    /**
+     * @endcond
+     */
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        SearchStats output = matcher1.get_stats();
+        output += matcher2.get_stats();
+        return output;
+    }
+#endif
+
     /**
      * @return Number of read pairs with a valid match to the first barcode but no valid match to the second barcode.
      */
-    int get_barcode1_only() const {
+    Count get_barcode1_only() const {
         return barcode1_only;
     }
 
     /**
      * @return Number of read pairs with a valid match to the second barcode but no valid match to the first barcode.
      */
-    int get_barcode2_only() const {
+    Count get_barcode2_only() const {
         return barcode2_only;
     }
 private:
@@ -244,9 +306,9 @@ private:
     bool use_first = true;
 
     std::vector<std::array<int, 2> > combinations;
-    int total = 0;
-    int barcode1_only = 0;
-    int barcode2_only = 0;
+    Count total = 0;
+    Count barcode1_only = 0;
+    Count barcode2_only = 0;
 };
 
 }
@@ -4,9 +4,11 @@
 #include "../ScanTemplate.hpp"
 #include "../BarcodeSearch.hpp"
 #include "../utils.hpp"
+#include "../serialize.hpp"
 
 #include <array>
 #include <vector>
+#include <cstdint>
 
 /**
  * @file CombinatorialBarcodesSingleEnd.hpp
@@ -25,9 +27,12 @@ namespace kaori {
  * This handler will capture the frequencies of each barcode combination. 
  *
  * @tparam max_size Maximum length of the template sequences on both reads.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
  * @tparam num_variable Number of variable regions in the construct.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size, size_t num_variable>
+template<size_t max_size, size_t num_variable, typename Count = uint64_t>
 class CombinatorialBarcodesSingleEnd {
 public:
     /**
@@ -98,12 +103,17 @@ public:
      */
     struct State {
         std::vector<std::array<int, num_variable> >collected;
-        int total = 0;
+        Count total = 0;
 
         std::array<int, num_variable> temp;
 
         // Default constructors should be called in this case, so it should be fine.
         std::array<typename SimpleBarcodeSearch::State, num_variable> forward_details, reverse_details;
+
+        typename ScanTemplate<max_size>::State scan;
+#ifdef KAORI_INSTRUMENT
+        SearchStats stats;
+#endif
     };
     /**
      * @endcond
@@ -157,7 +167,8 @@ private:
 
 private:
     void process_first(State& state, const std::pair<const char*, const char*>& x) const {
-        auto deets = constant_matcher.initialize(x.first, x.second - x.first);
+        auto& deets = state.scan;
+        constant_matcher.initialize(x.first, x.second - x.first, deets);
 
         while (!deets.finished) {
             constant_matcher.next(deets);
@@ -179,7 +190,8 @@ private:
     }
 
     void process_best(State& state, const std::pair<const char*, const char*>& x) const {
-        auto deets = constant_matcher.initialize(x.first, x.second - x.first);
+        auto& deets = state.scan;
+        constant_matcher.initialize(x.first, x.second - x.first, deets);
         bool found = false;
         int best_mismatches = max_mm + 1;
         std::array<int, num_variable> best_id;
@@ -239,12 +251,18 @@ public:
             }
         }
 
+#ifdef KAORI_INSTRUMENT
+        stats += s.stats;
+        s.stats = SearchStats();
+#endif
+
         combinations.insert(combinations.end(), s.collected.begin(), s.collected.end());
         total += s.total;
         return;
     }
 
     void process(State& state, const std::pair<const char*, const char*>& x) const {
+        KAORI_TIME(state, scan_time);
         if (use_first) {
             process_first(state, x);
         } else {
@@ -276,9 +294,65 @@ public:
     /**
      * @return Total number of reads processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return total;
     }
+
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        write_results_header(out, "CombinatorialBarcodesSingleEnd");
+        write_results_combinations(out, combinations);
+        write_results_value(out, total);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The combinations in `in` are appended to those of this instance, and the totals are added together.
+     * `sort()` may be called after all results have been merged.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        add_results(parse_results(in));
+    }
+
+    /**
+     * @cond
+     */
+    ParsedCombinations<num_variable, Count, 1> parse_results(std::istream& in) const {
+        return read_results_parsed_combinations<num_variable, Count, 1>(in, "CombinatorialBarcodesSingleEnd");
+    }
+
+    void add_results(const ParsedCombinations<num_variable, Count, 1>& parsed) {
+        parsed.add_to(combinations);
+        total += parsed.totals[0];
+    }
+    /**
+     * @endcond
+     */
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        SearchStats output = stats;
+        for (size_t r = 0; r < num_variable; ++r) {
+            if (forward) {
+                output += forward_lib[r].get_stats();
+            }
+            if (reverse) {
+                output += reverse_lib[r].get_stats();
+            }
+        }
+        return output;
+    }
+#endif
 private:
     bool forward;
     bool reverse;
@@ -291,7 +365,10 @@ private:
     std::array<size_t, num_variable> num_options;
 
     std::vector<std::array<int, num_variable> > combinations;
-    int total = 0;
+    Count total = 0;
+#ifdef KAORI_INSTRUMENT
+    SearchStats stats;
+#endif
 };
 
 }
@@ -4,6 +4,9 @@
 #include "../ScanTemplate.hpp"
 #include "../BarcodeSearch.hpp"
 #include "../utils.hpp"
+#include "../serialize.hpp"
+#include "../SparseCounts.hpp"
+#include <cstdint>
 
 /**
  * @file DualBarcodes.hpp
@@ -22,8 +25,11 @@ namespace kaori {
  * This handler will capture the frequencies of each barcode combination. 
  *
  * @tparam max_size Maximum length of the template sequences on both reads.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size>
+template<size_t max_size, typename Count = uint64_t>
 class DualBarcodes { 
 public:
     /**
@@ -146,26 +152,39 @@ public:
      *@cond
      */
     struct State {
-        State(size_t n = 0) : counts(n) {}
-        std::vector<int> counts;
-        int total = 0;
+        State() {}
+
+        SparseCounts<Count> hits;
+        Count total = 0;
 
         std::vector<std::pair<std::string, int> > buffer2;
 
         // Default constructors should be called in this case, so it should be fine.
         typename SegmentedBarcodeSearch<2>::State details;
+
+        typename ScanTemplate<max_size>::State scan1, scan2;
+#ifdef KAORI_INSTRUMENT
+        SearchStats stats;
+#endif
     };
 
     State initialize() const {
-        return State(counts.size());
+        return State();
     }
 
     void reduce(State& s) {
+        flush(s);
+    }
+
+    void flush(State& s) {
         varlib.reduce(s.details);
-        for (size_t i = 0; i < counts.size(); ++i) {
-            counts[i] += s.counts[i];
-        }
+#ifdef KAORI_INSTRUMENT
+        stats += s.stats;
+        s.stats = SearchStats();
+#endif
+        s.hits.transfer(counts);
         total += s.total;
+        s.total = 0;
     }
 
     constexpr static bool use_names = false;
@@ -216,10 +235,12 @@ private:
     }
 
     bool process_first(State& state, const std::pair<const char*, const char*>& against1, const std::pair<const char*, const char*>& against2) const {
-        auto deets1 = constant1.initialize(against1.first, against1.second - against1.first);
+        auto& deets1 = state.scan1;
+        constant1.initialize(against1.first, against1.second - against1.first, deets1);
         std::pair<std::string, int> match1;
 
-        auto deets2 = constant2.initialize(against2.first, against2.second - against2.first);
+        auto& deets2 = state.scan2;
+        constant2.initialize(against2.first, against2.second - against2.first, deets2);
         state.buffer2.clear();
 
         auto checker = [&](size_t idx2) -> bool {
@@ -228,7 +249,7 @@ private:
             varlib.search(combined, state.details, std::array<int, 2>{ max_mm1 - match1.second, max_mm2 - current2.second });
 
             if (state.details.index != -1) {
-                ++state.counts[state.details.index];
+                state.hits.add(state.details.index);
                 return true;
             } else {
                 return false;
@@ -259,10 +280,12 @@ private:
     }
 
     std::pair<int, int> process_best(State& state, const std::pair<const char*, const char*>& against1, const std::pair<const char*, const char*>& against2) const {
-        auto deets1 = constant1.initialize(against1.first, against1.second - against1.first);
+        auto& deets1 = state.scan1;
+        constant1.initialize(against1.first, against1.second - against1.first, deets1);
         std::pair<std::string, int> match1;
 
-        auto deets2 = constant2.initialize(against2.first, against2.second - against2.first);
+        auto& deets2 = state.scan2;
+        constant2.initialize(against2.first, against2.second - against2.first, deets2);
         state.buffer2.clear();
 
         int chosen = -1;
@@ -305,6 +328,7 @@ public:
      *@cond
      */
     bool process(State& state, const std::pair<const char*, const char*>& r1, const std::pair<const char*, const char*>& r2) const {
+        KAORI_TIME(state, scan_time);
         bool found;
 
         if (use_first) {
@@ -326,7 +350,7 @@ public:
 
             found = best.first >= 0;
             if (found) {
-                ++state.counts[best.first];
+                state.hits.add(best.first);
             }
         }
 
@@ -347,8 +371,11 @@ private:
     bool randomized;
     bool use_first = true;
 
-    std::vector<int> counts;
-    int total = 0;
+    std::vector<Count> counts;
+    Count total = 0;
+#ifdef KAORI_INSTRUMENT
+    SearchStats stats;
+#endif
 
 public:
     /**
@@ -356,16 +383,63 @@ public:
      * This has length equal to the number of valid dual barcode combinations (i.e., the length of `barcode_pool1` and `barcode_pool2` in the constructor).
      * Each entry contains the count for the corresponding dual barcode combination.
      */
-    const std::vector<int>& get_counts() const {
+    const std::vector<Count>& get_counts() const {
         return counts;
     }
 
     /**
      * @return Total number of read pairs processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return total;
     }
+
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        write_results_header(out, "DualBarcodes");
+        write_results_counts(out, counts);
+        write_results_value(out, total);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The counts and totals in `in` are added to those of this instance.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        add_results(parse_results(in));
+    }
+
+    /**
+     * @cond
+     */
+    ParsedCounts<Count> parse_results(std::istream& in) const {
+        return read_results_parsed_counts<Count>(in, counts.size(), "DualBarcodes");
+    }
+
+    void add_results(const ParsedCounts<Count>& parsed) {
+        parsed.add_to(counts, total);
+    }
+    /**
+     * @endcond
+     */
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        SearchStats output = stats;
+        output += varlib.get_stats();
+        return output;
+    }
+#endif
 };
 
 }
@@ -4,6 +4,7 @@
 #include "DualBarcodes.hpp"
 #include "CombinatorialBarcodesPairedEnd.hpp"
 #include "../utils.hpp"
+#include <cstdint>
 
 /**
  * @file DualBarcodesWithDiagnostics.hpp
@@ -21,8 +22,11 @@ namespace kaori {
  * The handler also counts the number of reads where only one barcode construct matches to a read.
  *
  * @tparam max_size Maximum length of the template sequences on both reads.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size>
+template<size_t max_size, typename Count = uint64_t>
 class DualBarcodesWithDiagnostics { 
 public:
     /**
@@ -71,8 +75,8 @@ public:
     }
 
 private:
-    DualBarcodes<max_size> dual_handler;
-    CombinatorialBarcodesPairedEnd<max_size> combo_handler;
+    DualBarcodes<max_size, Count> dual_handler;
+    CombinatorialBarcodesPairedEnd<max_size, Count> combo_handler;
 
 public:
     /**
@@ -80,13 +84,13 @@ public:
      */
     struct State {
         State() {}
-        State(typename DualBarcodes<max_size>::State ds, typename CombinatorialBarcodesPairedEnd<max_size>::State cs) : dual_state(std::move(ds)), combo_state(std::move(cs)) {}
+        State(typename DualBarcodes<max_size, Count>::State ds, typename CombinatorialBarcodesPairedEnd<max_size, Count>::State cs) : dual_state(std::move(ds)), combo_state(std::move(cs)) {}
 
         /**
          * @cond
          */
-        typename DualBarcodes<max_size>::State dual_state;
-        typename CombinatorialBarcodesPairedEnd<max_size>::State combo_state;
+        typename DualBarcodes<max_size, Count>::State dual_state;
+        typename CombinatorialBarcodesPairedEnd<max_size, Count>::State combo_state;
         /**
          * @endcond
          */
@@ -101,6 +105,11 @@ public:
         combo_handler.reduce(s.combo_state);
     }
 
+    void flush(State& s) {
+        dual_handler.flush(s.dual_state);
+        combo_handler.reduce(s.combo_state);
+    }
+
     constexpr static bool use_names = false;
     /**
      *@endcond
@@ -134,13 +143,14 @@ public:
      * This has length equal to the number of valid dual barcode combinations (i.e., the length of `barcode_pool1` and `barcode_pool2` in the constructor).
      * Each entry contains the count for the corresponding dual barcode combination.
      */
-    const std::vector<int>& get_counts() const {
+    const std::vector<Count>& get_counts() const {
         return dual_handler.get_counts();
     }
 
     /**
      * @return All invalid combinations encountered by the handler.
      * In each array, the first and second element contains the indices of known barcodes in the first and second pools, respectively.
+     * With multiple threads, the order of combinations depends on the order in which blocks were processed, so `sort()` should be called before comparing results.
      */
     const std::vector<std::array<int, 2> >& get_combinations() const {
         return combo_handler.get_combinations();
@@ -149,23 +159,59 @@ public:
     /**
      * @return Total number of read pairs processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return dual_handler.get_total();
     }
 
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        SearchStats output = dual_handler.get_stats();
+        output += combo_handler.get_stats();
+        return output;
+    }
+#endif
+
     /**
      * @return Number of read pairs with a valid match to the first barcode but no valid match to the second barcode.
      */
-    int get_barcode1_only() const {
+    Count get_barcode1_only() const {
         return combo_handler.get_barcode1_only();
     }
 
     /**
      * @return Number of read pairs with a valid match to the second barcode but no valid match to the first barcode.
      */
-    int get_barcode2_only() const {
+    Count get_barcode2_only() const {
         return combo_handler.get_barcode2_only();
     }
+
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        dual_handler.write_results(out);
+        combo_handler.write_results(out);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The counts for valid combinations are added to those of this instance, while the invalid combinations are appended.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        // Parsing both sets of results before adding either of them.
+        auto dual_parsed = dual_handler.parse_results(in);
+        auto combo_parsed = combo_handler.parse_results(in);
+        dual_handler.add_results(dual_parsed);
+        combo_handler.add_results(combo_parsed);
+    }
 };
 
 }
@@ -2,7 +2,10 @@
 #define KAORI_SINGLE_BARCODE_PAIRED_END_HPP
 
 #include "../SimpleSingleMatch.hpp"
+#include "../serialize.hpp"
+#include "../SparseCounts.hpp"
 #include <vector>
+#include <cstdint>
 
 /**
  * @file SingleBarcodePairedEnd.hpp
@@ -20,8 +23,11 @@ namespace kaori {
  * This handler will search both reads for the target sequence and count the frequency of each barcode.
  *
  * @tparam max_size Maximum length of the template sequence.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size>
+template<size_t max_size, typename Count = uint64_t>
 class SingleBarcodePairedEnd {
 public:
     /**
@@ -54,19 +60,20 @@ public:
     struct State {
         State() {}
 
-        State(typename SimpleSingleMatch<max_size>::State s, size_t nvar) : search(std::move(s)), counts(nvar) {}
+        State(typename SimpleSingleMatch<max_size>::State s) : search(std::move(s)) {}
 
         typename SimpleSingleMatch<max_size>::State search;
-        std::vector<int> counts;
-        int total = 0;
+
+        SparseCounts<Count> hits;
+        Count total = 0;
     };
 
     void process(State& state, const std::pair<const char*, const char*>& r1, const std::pair<const char*, const char*>& r2) const {
         if (use_first) {
             if (matcher.search_first(r1.first, r1.second - r1.first, state.search)) {
-                ++state.counts[state.search.index];
+                state.hits.add(state.search.index);
             } else if (matcher.search_first(r2.first, r2.second - r2.first, state.search)) {
-                ++state.counts[state.search.index];
+                state.hits.add(state.search.index);
             }
         } else {
             bool found1 = matcher.search_best(r1.first, r1.second - r1.first, state.search);
@@ -78,16 +85,16 @@ public:
             auto mm2 = state.search.mismatches;
 
             if (found1 && !found2) {
-                ++state.counts[id1];
+                state.hits.add(id1);
             } else if (!found1 && found2) {
-                ++state.counts[id2];
+                state.hits.add(id2);
             } else if (found1 && found2) {
                 if (mm1 < mm2) {
-                    ++state.counts[id1];
+                    state.hits.add(id1);
                 } else if (mm1 > mm2) {
-                    ++state.counts[id2];
+                    state.hits.add(id2);
                 } else if (id1 == id2) {
-                    ++state.counts[id1];
+                    state.hits.add(id1);
                 }
             }
         }
@@ -104,15 +111,18 @@ public:
      * @cond
      */
     State initialize() const {
-        return State(matcher.initialize(), counts.size());
+        return State(matcher.initialize());
     }
 
     void reduce(State& s) {
+        flush(s);
+    }
+
+    void flush(State& s) {
         matcher.reduce(s.search);
-        for (size_t i = 0; i < counts.size(); ++i) {
-            counts[i] += s.counts[i];
-        }
+        s.hits.transfer(counts);
         total += s.total;
+        s.total = 0;
     }
     /**
      * @endcond
@@ -120,8 +130,8 @@ public:
 
 private:
     SimpleSingleMatch<max_size> matcher;
-    std::vector<int> counts;
-    int total = 0;
+    std::vector<Count> counts;
+    Count total = 0;
     bool use_first = true;
 
 public:
@@ -129,16 +139,61 @@ public:
      * @return Vector containing the frequency of each barcode.
      * This has length equal to the number of valid barcodes (i.e., the length of `barcode_pool` in the constructor).
      */
-    const std::vector<int>& get_counts() const {
+    const std::vector<Count>& get_counts() const {
         return counts;        
     }
 
     /**
      * @return Total number of reads processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return total;
     }
+
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        write_results_header(out, "SingleBarcodePairedEnd");
+        write_results_counts(out, counts);
+        write_results_value(out, total);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The counts and totals in `in` are added to those of this instance.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        add_results(parse_results(in));
+    }
+
+    /**
+     * @cond
+     */
+    ParsedCounts<Count> parse_results(std::istream& in) const {
+        return read_results_parsed_counts<Count>(in, counts.size(), "SingleBarcodePairedEnd");
+    }
+
+    void add_results(const ParsedCounts<Count>& parsed) {
+        parsed.add_to(counts, total);
+    }
+    /**
+     * @endcond
+     */
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        return matcher.get_stats();
+    }
+#endif
 };
 
 }
@@ -2,7 +2,10 @@
 #define KAORI_SINGLE_BARCODE_SINGLE_END_HPP
 
 #include "../SimpleSingleMatch.hpp"
+#include "../serialize.hpp"
+#include "../SparseCounts.hpp"
 #include <vector>
+#include <cstdint>
 
 /**
  * @file SingleBarcodeSingleEnd.hpp
@@ -20,8 +23,11 @@ namespace kaori {
  * This handler will search the read for the target sequence and count the frequency of each barcode.
  *
  * @tparam max_size Maximum length of the template sequences on both reads.
+ * If zero, the template length is only determined at run time, see `ScanTemplate` for details.
+ * @tparam Count Integer type for the counts and totals.
+ * This defaults to a 64-bit type so that deeply sequenced libraries do not overflow.
  */
-template<size_t max_size>
+template<size_t max_size, typename Count = uint64_t>
 class SingleBarcodeSingleEnd {
 public:
     /**
@@ -54,11 +60,12 @@ public:
     struct State {
         State() {}
 
-        State(typename SimpleSingleMatch<max_size>::State s, size_t nvar) : search(std::move(s)), counts(nvar) {}
+        State(typename SimpleSingleMatch<max_size>::State s) : search(std::move(s)) {}
 
         typename SimpleSingleMatch<max_size>::State search;
-        std::vector<int> counts;
-        int total = 0;
+
+        SparseCounts<Count> hits;
+        Count total = 0;
     };
 
     void process(State& state, const std::pair<const char*, const char*>& x) const {
@@ -69,11 +76,20 @@ public:
             found = matcher.search_best(x.first, x.second - x.first, state.search);
         }
         if (found) {
-            ++(state.counts[state.search.index]);
+            state.hits.add(state.search.index);
         }
         ++state.total;
     }
 
+    void process_batch(State& state, const std::pair<const char*, const char*>* x, size_t n) const {
+        matcher.search_batch(x, n, use_first, state.search, [&](size_t, bool found) -> void {
+            if (found) {
+                state.hits.add(state.search.index);
+            }
+        });
+        state.total += n;
+    }
+
     static constexpr bool use_names = false;
     /**
      * @endcond
@@ -84,15 +100,18 @@ public:
      * @cond
      */
     State initialize() const {
-        return State(matcher.initialize(), counts.size());
+        return State(matcher.initialize());
     }
 
     void reduce(State& s) {
+        flush(s);
+    }
+
+    void flush(State& s) {
         matcher.reduce(s.search);
-        for (size_t i = 0; i < counts.size(); ++i) {
-            counts[i] += s.counts[i];
-        }
+        s.hits.transfer(counts);
         total += s.total;
+        s.total = 0;
     }
     /**
      * @endcond
@@ -100,8 +119,8 @@ public:
 
 private:
     SimpleSingleMatch<max_size> matcher;
-    std::vector<int> counts;
-    int total = 0;
+    std::vector<Count> counts;
+    Count total = 0;
     bool use_first = true;
 
 public:
@@ -109,16 +128,61 @@ public:
      * @return Vector containing the frequency of each barcode.
      * This has length equal to the number of valid barcodes (i.e., the length of `barcode_pool` in the constructor).
      */
-    const std::vector<int>& get_counts() const {
+    const std::vector<Count>& get_counts() const {
         return counts;        
     }
 
     /**
      * @return Total number of reads processed by the handler.
      */
-    int get_total() const {
+    Count get_total() const {
         return total;
     }
+
+    /**
+     * Serialize the results of this handler, see serialize.hpp for details.
+     *
+     * @param out Output stream to write the results to.
+     */
+    void write_results(std::ostream& out) const {
+        write_results_header(out, "SingleBarcodeSingleEnd");
+        write_results_counts(out, counts);
+        write_results_value(out, total);
+    }
+
+    /**
+     * Merge serialized results into this handler, see serialize.hpp for details.
+     * The counts and totals in `in` are added to those of this instance.
+     *
+     * @param in Input stream containing results from `write_results()`.
+     */
+    void merge_results(std::istream& in) {
+        add_results(parse_results(in));
+    }
+
+    /**
+     * @cond
+     */
+    ParsedCounts<Count> parse_results(std::istream& in) const {
+        return read_results_parsed_counts<Count>(in, counts.size(), "SingleBarcodeSingleEnd");
+    }
+
+    void add_results(const ParsedCounts<Count>& parsed) {
+        parsed.add_to(counts, total);
+    }
+    /**
+     * @endcond
+     */
+
+#ifdef KAORI_INSTRUMENT
+    /**
+     * @return Statistics for the barcode searches, see `SearchStats`.
+     * Only available if `KAORI_INSTRUMENT` is defined.
+     */
+    SearchStats get_stats() const {
+        return matcher.get_stats();
+    }
+#endif
 };
 
 }
@@ -2,8 +2,23 @@
 #define KAORI_PROCESS_DATA_HPP
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <chrono>
+#include <type_traits>
+#include <utility>
 #include "FastqReader.hpp"
+#include "ThreadPool.hpp"
+#include "BlockSize.hpp"
+#include "Progress.hpp"
+#include "ReadArray.hpp"
 #include "byteme/Reader.hpp"
+#include "byteme/RawBufferReader.hpp"
 
 /**
  * @file process_data.hpp
@@ -29,18 +44,29 @@ struct ChunkOfReads {
         }
     }
 
-    void add_read_sequence(const std::vector<char>& sequence) {
+    void add_read_sequence(const std::pair<const char*, const char*>& sequence) {
         add_read_details(sequence, sequence_buffer, sequence_offset);
     }
 
-    void add_read_name(const std::vector<char>& name) {
+    void add_read_name(const std::pair<const char*, const char*>& name) {
         add_read_details(name, name_buffer, name_offset);
     }
 
+    // For parsers that can write the sequence directly into the buffer.
+    template<class Parser>
+    void add_read_sequence(const Parser& parser, size_t window_start, size_t window_end) {
+        parser.append_sequence(sequence_buffer, window_start, window_end);
+        sequence_offset.push_back(sequence_buffer.size());
+    }
+
     size_t size() const {
         return sequence_offset.size() - 1;
     }
 
+    size_t bytes() const {
+        return sequence_buffer.size() + name_buffer.size();
+    }
+
     std::pair<const char*, const char*> get_sequence(size_t i) const {
         return get_details(i, sequence_buffer, sequence_offset);
     }
@@ -55,10 +81,10 @@ private:
     std::vector<char> name_buffer;
     std::vector<size_t> name_offset;
 
-    static void add_read_details(const std::vector<char>& src, std::vector<char>& dst, std::vector<size_t>& offset) {
-        dst.insert(dst.end(), src.begin(), src.end());
+    static void add_read_details(const std::pair<const char*, const char*>& src, std::vector<char>& dst, std::vector<size_t>& offset) {
+        dst.insert(dst.end(), src.first, src.second);
         auto last = offset.back();
-        offset.push_back(last + src.size());
+        offset.push_back(last + (src.second - src.first));
     }
 
     static std::pair<const char*, const char*> get_details(size_t i, const std::vector<char>& dest, const std::vector<size_t>& offset) {
@@ -66,19 +92,371 @@ private:
         return std::make_pair(base + offset[i], base + offset[i + 1]);
     }
 };
+
+inline std::pair<const char*, const char*> restrict_to_window(const std::pair<const char*, const char*>& x, size_t window_start, size_t window_end) {
+    size_t len = x.second - x.first;
+    return std::make_pair(x.first + std::min(window_start, len), x.first + std::min(window_end, len));
+}
+
+inline void check_window(size_t window_start, size_t window_end) {
+    if (window_start > window_end) {
+        throw std::runtime_error("window start should be no greater than the window end");
+    }
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template<class Parser, typename = void>
+struct has_append_sequence : std::false_type {};
+
+template<class Parser>
+struct has_append_sequence<Parser, std::void_t<decltype(std::declval<const Parser&>().append_sequence(std::declval<std::vector<char>&>(), size_t(0), size_t(0)))> > : std::true_type {};
+
+template<bool use_names, class Parser>
+void add_parsed_read(const Parser& parser, ChunkOfReads<use_names>& curreads, size_t window_start, size_t window_end) {
+    if constexpr(has_append_sequence<Parser>::value) {
+        curreads.add_read_sequence(parser, window_start, window_end);
+    } else {
+        curreads.add_read_sequence(restrict_to_window(parser.get_sequence_view(), window_start, window_end));
+    }
+    if constexpr(use_names) {
+        curreads.add_read_name(parser.get_name_view());
+    }
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @cond
+ */
+template<bool use_names>
+struct PairOfChunks {
+    ChunkOfReads<use_names> first, second;
+
+    void clear() {
+        first.clear();
+        second.clear();
+    }
+};
+
+template<class Handler, class State, typename = void>
+struct has_process_batch : std::false_type {};
+
+template<class Handler, class State>
+struct has_process_batch<Handler, State, std::void_t<decltype(std::declval<const Handler&>().process_batch(std::declval<State&>(), std::declval<const std::pair<const char*, const char*>*>(), size_t(0)))> > : std::true_type {};
+
+template<class Handler, class State, typename = void>
+struct has_flush : std::false_type {};
+
+template<class Handler, class State>
+struct has_flush<Handler, State, std::void_t<decltype(std::declval<Handler&>().flush(std::declval<State&>()))> > : std::true_type {};
+
+// Pipeline with a parsing stage on the calling thread, a processing stage on
+// the workers in 'pool', and a reduction stage on a dedicated thread. Chunks
+// and states are recycled through free lists so that memory usage is bounded.
+//
+// - parse(Chunk&) fills a cleared chunk and returns whether the input is exhausted.
+// - process(const Chunk&, State&) is run on the workers.
+// - handler.reduce() and handler.initialize() are only ever called from the
+//   reduction thread (or outside of it), so they never run concurrently with
+//   each other.
+// - handler.reduce() runs concurrently with process() on other states, so
+//   that reduction stays off the critical path and the workers never wait
+//   for it. This is safe as reduce() only modifies the handler's results,
+//   which process() does not read, and the search caches, which process()
+//   only reads through immutable snapshots (see SharedCache).
+//
+// The parser only waits when no chunk is free, i.e., it never waits for any
+// specific worker. Workers release their chunk as soon as they are done, and
+// states are reduced in the order that their chunks were parsed.
+//
+// If the handler has a flush() method, there is exactly one state per worker,
+// which persists for the whole run and is only ever touched by that worker.
+// Each worker calls flush() on its own state after processing each block,
+// which merges the results and the search caches into the handler; calls to
+// flush() are serialized but may overlap with process() on other workers, in
+// the same manner as reduce(). The reducer then only reports progress, and
+// every state is reduced exactly once at the end. This keeps the number of
+// states at the number of workers rather than the number of blocks in flight.
+//
+// observe(size_t, double) is called on the reduction thread with the number of
+// blocks reduced so far and the time spent reducing (or flushing) the latest
+// block. If it returns false, the parser stops at the next block.
+template<class Chunk, class Handler, class Parse, class Process, class Observe>
+void run_pipeline(ThreadPool& pool, Handler& handler, Parse parse, Process process, Observe observe) {
+    typedef decltype(handler.initialize()) State;
+    constexpr bool persistent = has_flush<Handler, State>::value;
+
+    size_t num_chunks = 2 * pool.size();
+    size_t num_states = (persistent ? pool.size() : 2 * num_chunks); // some slack for out-of-order completion.
+
+    std::vector<Chunk> chunks(num_chunks);
+    std::vector<size_t> free_chunks;
+    free_chunks.reserve(num_chunks);
+    for (size_t c = 0; c < num_chunks; ++c) {
+        free_chunks.push_back(c);
+    }
+
+    std::vector<State> states(num_states);
+    std::vector<size_t> free_states;
+    free_states.reserve(num_states);
+    for (size_t s = 0; s < num_states; ++s) {
+        states[s] = handler.initialize();
+        free_states.push_back(s);
+    }
+
+    std::mutex mut, flush_mut;
+    std::condition_variable cv;
+    std::map<size_t, std::pair<size_t, double> > completed; // parse order -> state index, time spent flushing.
+    size_t submitted = 0, reduced = 0, in_flight = 0;
+    bool parsing_done = false, stopped = false;
+    std::exception_ptr error;
+
+    auto fail = [&]() -> void {
+        std::lock_guard<std::mutex> lck(mut);
+        if (!error) {
+            error = std::current_exception();
+        }
+    };
+
+    std::thread reducer([&]() -> void {
+        std::unique_lock<std::mutex> lck(mut);
+        while (1) {
+            cv.wait(lck, [&]() -> bool { 
+                return error || completed.count(reduced) || (parsing_done && reduced == submitted); 
+            });
+            if (error || !completed.count(reduced)) {
+                return;
+            }
+
+            // Draining all states that are ready to be reduced in order. In
+            // persistent mode, the workers have already flushed their states,
+            // so we only need to report progress in order.
+            while (!error) {
+                auto it = completed.find(reduced);
+                if (it == completed.end()) {
+                    break;
+                }
+                size_t s = it->second.first;
+                double elapsed = it->second.second;
+                completed.erase(it);
+
+                lck.unlock();
+                bool keep_going = true;
+                try {
+                    if constexpr(!persistent) {
+                        auto start = std::chrono::steady_clock::now();
+                        handler.reduce(states[s]);
+                        states[s] = handler.initialize();
+                        elapsed = seconds_since(start);
+                    }
+                    keep_going = observe(reduced + 1, elapsed);
+                } catch (...) {
+                    fail();
+                }
+                lck.lock();
+
+                ++reduced;
+                if constexpr(!persistent) {
+                    free_states.push_back(s);
+                }
+                if (!keep_going) {
+                    stopped = true;
+                }
+                cv.notify_all();
+            }
+        }
+    });
+
+    try {
+        bool finished = false;
+        while (!finished) {
+            size_t c, s = 0;
+            {
+                std::unique_lock<std::mutex> lck(mut);
+                cv.wait(lck, [&]() -> bool { return error || stopped || (!free_chunks.empty() && (persistent || !free_states.empty())); });
+                if (error || stopped) {
+                    break;
+                }
+                c = free_chunks.back();
+                free_chunks.pop_back();
+                if constexpr(!persistent) {
+                    s = free_states.back();
+                    free_states.pop_back();
+                }
+            }
+
+            auto& chunk = chunks[c];
+            chunk.clear();
+            finished = parse(chunk);
+
+            size_t order;
+            {
+                std::lock_guard<std::mutex> lck(mut);
+                order = submitted;
+                ++submitted;
+                ++in_flight;
+            }
+
+            pool.submit([&, c, s, order]() -> void {
+                size_t current = s;
+                double elapsed = 0;
+                if constexpr(persistent) {
+                    current = pool.worker_index();
+                }
+
+                try {
+                    process(chunks[c], states[current]);
+                    if constexpr(persistent) {
+                        auto start = std::chrono::steady_clock::now();
+                        std::lock_guard<std::mutex> flck(flush_mut);
+                        handler.flush(states[current]);
+                        elapsed = seconds_since(start);
+                    }
+                } catch (...) {
+                    fail();
+                }
+                // Notifying while holding the lock, otherwise the parser might
+                // see in_flight == 0 and destroy 'cv' before we notify.
+                std::lock_guard<std::mutex> lck(mut);
+                free_chunks.push_back(c);
+                completed[order] = std::make_pair(current, elapsed);
+                --in_flight;
+                cv.notify_all();
+            });
+        }
+    } catch (...) {
+        fail();
+    }
+
+    // Waiting for all tasks and the reducer, as they refer to our local variables.
+    {
+        std::unique_lock<std::mutex> lck(mut);
+        parsing_done = true;
+        cv.notify_all();
+        cv.wait(lck, [&]() -> bool { return in_flight == 0; });
+    }
+    cv.notify_all();
+    reducer.join();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    if constexpr(persistent) {
+        for (auto& state : states) {
+            handler.reduce(state);
+        }
+    }
+}
 /**
  * @endcond
  */
 
+/**
+ * Perform a handler for each read in single-end data, using an existing pool of worker threads.
+ * This allows the same workers to be reused across multiple calls, e.g., when processing several files.
+ *
+ * @tparam Handler A class that implements a handler for single-end data, see the other `process_single_end_data()` overload for requirements.
+ * @tparam Parser Class template for parsing records from `input`, see the other `process_single_end_data()` overload.
+ *
+ * @param input A `Reader` object containing data from a single-end FASTQ file (or another format, depending on `Parser`).
+ * @param handler Instance of the `Handler` class.
+ * @param pool Pool of worker threads to use for processing.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see the other `process_single_end_data()` overload.
+ * @param window_end Position on each read at which to end the window, see the other `process_single_end_data()` overload.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_single_end_data(byteme::Reader* input, Handler& handler, ThreadPool& pool, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    check_window(window_start, window_end);
+    Parser<Handler::use_names> fastq(input, true);
+
+    // Safety measure to enforce const-ness within each thread.
+    const Handler& conhandler = handler;
+    typedef ChunkOfReads<Handler::use_names> Chunk;
+    typedef decltype(handler.initialize()) State;
+
+    BlockTracker tracker(block_size);
+
+    run_pipeline<Chunk>(
+        pool,
+        handler,
+        [&](Chunk& curreads) -> bool {
+            int limit = tracker.next();
+            auto start = std::chrono::steady_clock::now();
+            bool finished = false;
+
+            for (int b = 0; b < limit; ++b) {
+                if (!fastq()) {
+                    finished = true;
+                    break;
+                }
+                add_parsed_read(fastq, curreads, window_start, window_end);
+            }
+
+            tracker.record_parse(curreads.size(), curreads.bytes(), seconds_since(start));
+            return finished;
+        },
+        [&](const Chunk& curreads, State& state) -> void {
+            auto start = std::chrono::steady_clock::now();
+            size_t nreads = curreads.size();
+            if constexpr(!Handler::use_names) {
+                if constexpr(has_process_batch<Handler, State>::value) {
+                    // Re-used across blocks on each worker.
+                    thread_local std::vector<std::pair<const char*, const char*> > seqs;
+                    seqs.clear();
+                    for (size_t b = 0; b < nreads; ++b) {
+                        seqs.push_back(curreads.get_sequence(b));
+                    }
+                    conhandler.process_batch(state, seqs.data(), nreads);
+                } else {
+                    for (size_t b = 0; b < nreads; ++b) {
+                        conhandler.process(state, curreads.get_sequence(b));
+                    }
+                }
+            } else {
+                for (size_t b = 0; b < nreads; ++b) {
+                    conhandler.process(state, curreads.get_name(b), curreads.get_sequence(b));
+                }
+            }
+            tracker.record_process(nreads, seconds_since(start));
+        },
+        [&](size_t blocks, double reduce_time) -> bool { return tracker.report(observer, blocks, reduce_time); }
+    );
+
+    return;
+}
+
 /**
  * Perform a handler for each read in single-end data.
  *
  * @tparam Handler A class that implements a handler for single-end data.
+ * @tparam Parser Class template for parsing records from `input`, e.g., `FastqReader`, `FastaReader` or `BamReader`.
+ * This should accept a single `bool` template argument specifying whether to store the read names,
+ * and should have the same constructor and methods as `FastqReader`.
+ * If it also has an `append_sequence()` method like `BamReader`, this is used to write each sequence directly into the block of reads.
  *
- * @param input A `Reader` object containing data from a single-end FASTQ file.
+ * @param input A `Reader` object containing data from a single-end FASTQ file (or another format, depending on `Parser`).
  * @param handler Instance of the `Handler` class.
  * @param num_threads Number of threads to use for processing.
- * @param block_size Number of reads in each thread.
+ * A `ThreadPool` of this size is created for the duration of the call.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window.
+ * Only the part of each read sequence in `[window_start, window_end)` is retained and passed to the handler.
+ * This reduces memory usage and search time when the target sequence is known to lie in a particular region of the read.
+ * @param window_end Position on each read at which to end the window.
+ * Reads shorter than `window_end` are truncated at their ends.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
  *
  * @return `handler.process()` is called on each read.
  * It is expected that the results are stored in `handler` for retrieval by the caller.
@@ -89,13 +467,22 @@ private:
  *   The idea is to store results in the state object for thread-safe execution.
  *   The state object should be default-constructible.
  * - `reduce(State& state)`: this should merge the results from the `state` object into the `Handler` instance.
- *   This will be called in a serial section and does not have to be thread-safe.
+ *   Calls to `reduce()` are serialized, but they may run concurrently with `process()` on other state objects.
+ *   Thus, `reduce()` should not modify anything that `process()` reads from the `Handler`, other than via the `reduce()` methods of the search classes (e.g., `SimpleBarcodeSearch::reduce()`), which are safe in this respect.
+ * - (optional) `flush(State& state)`: this should merge the per-read results (e.g., barcode counts) and the search caches from `state` into the `Handler` instance, and clear them from `state`.
+ *   If this method is present, each worker thread owns a single state object that persists across blocks, and the worker calls `flush()` on its state after processing each block,
+ *   while `reduce()` is only called once for each state object at the end of the run.
+ *   This avoids the cost of calling `initialize()` for every block, while still sharing the search caches across threads and keeping the caches in each state bounded by the size of a block.
+ *   Like `reduce()`, calls to `flush()` are serialized but may run concurrently with `process()` on other states.
+ *   Note that this assumes that the results of `reduce()` do not depend on the order in which reads are processed.
  *
  * The `Handler` should have a static `constexpr` variable `use_names`, indicating whether or not names should be passed to the `process()` method.
  *
  * If `use_names` is `false`, the `Handler` class should implement:
  * - `process(State& state, const std::pair<const char*, const char*>& seq)`: this should be a `const` method that processes the read in `seq` and stores its results in `state`.
  *   `seq` will contain pointers to the start and one-past-the-end of the read sequence.
+ * - (optional) `process_batch(State& state, const std::pair<const char*, const char*>* seqs, size_t num_seqs)`: this should be a `const` method that is equivalent to calling `process()` on each of the `num_seqs` reads in `seqs`.
+ *   If present, it is called on each block of reads by `process_single_end_data()`, e.g., to scan several reads side by side with `ScanTemplate::scan_batch()`.
  *
  * Otherwise, if `use_names` is `true`, the class should implement:
  * - `process(State& state, const std::pair<const char*, const char*>& name, const std::pair<const char*, const char*>& seq)`: 
@@ -103,102 +490,270 @@ private:
  *   `name` will contain pointers to the start and one-past-the-end of the read name.
  *   `seq` will contain pointers to the start and one-past-the-end of the read sequence.
  */
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_single_end_data(byteme::Reader* input, Handler& handler, int num_threads = 1, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_single_end_data<Handler, Parser>(input, handler, pool, block_size, window_start, window_end, observer);
+}
+
+/**
+ * Perform a handler for each read in single-end data that is already in memory, using an existing pool of worker threads.
+ * This allows the same workers to be reused across multiple calls.
+ *
+ * @tparam Handler A class that implements a handler for single-end data.
+ *
+ * @param buffer Pointer to a buffer containing the contents of an uncompressed FASTQ file, see the other `process_single_end_buffer()` overload.
+ * @param length Length of the buffer.
+ * @param handler Instance of the `Handler` class, see `process_single_end_data()` for requirements.
+ * @param pool Pool of worker threads to use for parsing and processing.
+ * @param chunk_size Number of bytes in each range to be processed by a task.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
 template<class Handler>
-void process_single_end_data(byteme::Reader* input, Handler& handler, int num_threads = 1, int block_size = 100000) {
-    FastqReader fastq(input);
-    bool finished = false;
-
-    std::vector<ChunkOfReads<Handler::use_names> > reads(num_threads);
-    std::vector<std::thread> jobs(num_threads);
-    std::vector<decltype(handler.initialize())> states(num_threads);
-    std::vector<std::string> errs(num_threads);
-
-    auto join = [&](int i) -> void {
-        if (jobs[i].joinable()) {
-            jobs[i].join();
-            if (errs[i] != "") {
-                throw std::runtime_error(errs[i]);
-            }
-            handler.reduce(states[i]);
-            reads[i].clear();
-        }
-    };
+void process_single_end_buffer(const char* buffer, size_t length, Handler& handler, ThreadPool& pool, size_t chunk_size = 10000000, size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    check_window(window_start, window_end);
+    size_t num_chunks = length / chunk_size + (length % chunk_size > 0);
+    if (num_chunks == 0) {
+        return;
+    }
 
     // Safety measure to enforce const-ness within each thread.
     const Handler& conhandler = handler;
 
-    try {
-        while (!finished) {
-            for (int t = 0; t < num_threads; ++t) {
-                join(t);
-
-                auto& curreads = reads[t];
-                for (int b = 0; b < block_size; ++b) {
-                    if (!fastq()) {
-                        finished = true;
-                        break;
-                    }
+    // Each "chunk" is just the index of the byte range to be processed.
+    struct Range {
+        size_t index = 0;
+        void clear() {}
+    };
+    size_t next_range = 0;
+    typedef decltype(handler.initialize()) State;
+    BlockTracker tracker(BlockSize{});
 
-                    curreads.add_read_sequence(fastq.get_sequence());
-                    if constexpr(Handler::use_names) {
-                        curreads.add_read_name(fastq.get_name());
-                    }
+    run_pipeline<Range>(
+        pool,
+        handler,
+        [&](Range& range) -> bool {
+            range.index = next_range;
+            ++next_range;
+            return next_range == num_chunks;
+        },
+        [&](const Range& range, State& state) -> void {
+            // Each task independently finds its own boundaries,
+            // which is fine as the search is deterministic.
+            size_t c = range.index;
+            size_t start = find_next_fastq_record(buffer, length, c * chunk_size);
+            size_t end = find_next_fastq_record(buffer, length, std::min((c + 1) * chunk_size, length));
+            if (start >= end) {
+                return;
+            }
+
+            auto timer = std::chrono::steady_clock::now();
+            size_t nreads = 0, nbytes = 0;
+            byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer + start), end - start);
+            FastqReader<Handler::use_names> fastq(&reader, true);
+            while (fastq()) {
+                auto seq = restrict_to_window(fastq.get_sequence_view(), window_start, window_end);
+                nbytes += seq.second - seq.first;
+                if constexpr(!Handler::use_names) {
+                    conhandler.process(state, seq);
+                } else {
+                    auto name = fastq.get_name_view();
+                    nbytes += name.second - name.first;
+                    conhandler.process(state, name, seq);
                 }
+                ++nreads;
+            }
 
-                states[t] = handler.initialize();
-                jobs[t] = std::thread([&](int i) -> void {
-                    try {
-                        auto& state = states[i];
-                        const auto& curreads = reads[i];
-                        size_t nreads = curreads.size();
-
-                        if constexpr(!Handler::use_names) {
-                            for (size_t b = 0; b < nreads; ++b) {
-                                conhandler.process(state, curreads.get_sequence(b));
-                            }
-                        } else {
-                            for (size_t b = 0; b < nreads; ++b) {
-                                conhandler.process(state, curreads.get_name(b), curreads.get_sequence(b));
-                            }
-                        }
-                    } catch (std::exception& e) {
-                        errs[i] = std::string(e.what());
-                    }
-                }, t);
-
-                if (finished) {
-                    // We won't get a future iteration to join the previous threads
-                    // that we kicked off, so we do it now.
-                    for (int u = 0; u < num_threads; ++u) {
-                        auto pos = (u + t + 1) % num_threads;
-                        join(pos);
-                    }
-                    break;
+            // Parsing and processing are interleaved here, so all of the time is attributed to processing.
+            tracker.record_parse(nreads, nbytes, 0);
+            tracker.record_process(nreads, seconds_since(timer));
+        },
+        [&](size_t blocks, double reduce_time) -> bool { return tracker.report(observer, blocks, reduce_time); }
+    );
+
+    return;
+}
+
+/**
+ * Perform a handler for each read in single-end data that is already in memory, typically via `MappedFile`.
+ * Unlike `process_single_end_data()`, parsing is performed in parallel by splitting the buffer into byte ranges. 
+ * Each thread locates the first record in its range with `find_next_fastq_record()` and then parses the records in that range.
+ * This allows throughput to scale with the number of threads, rather than being limited by the speed of a single parsing thread. 
+ * It also avoids copying read sequences (and names) as they are passed to the handler directly from the buffer.
+ *
+ * @tparam Handler A class that implements a handler for single-end data.
+ *
+ * @param buffer Pointer to a buffer containing the contents of an uncompressed FASTQ file.
+ * Each record should have its sequence and quality strings on a single line.
+ * @param length Length of the buffer.
+ * @param handler Instance of the `Handler` class, see `process_single_end_data()` for requirements.
+ * @param num_threads Number of threads to use for parsing and processing.
+ * @param chunk_size Number of bytes in each range to be processed by a thread.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler>
+void process_single_end_buffer(const char* buffer, size_t length, Handler& handler, int num_threads = 1, size_t chunk_size = 10000000, size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_single_end_buffer(buffer, length, handler, pool, chunk_size, window_start, window_end, observer);
+}
+
+/**
+ * @cond
+ */
+// Shared by the paired-end overloads, which only differ in how each block is
+// parsed. fill(PairOfChunks&, int) should add up to the specified number of
+// read pairs to the chunk and return whether the input is exhausted. The
+// number of pairs is fixed before parsing each block, so that both mates are
+// filled in lock-step even when sizing by bytes.
+template<class Handler, class Fill>
+void run_paired_end_pipeline(Handler& handler, ThreadPool& pool, const BlockSize& block_size, const ProgressCallback& observer, Fill fill) {
+    // Safety measure to enforce const-ness within each thread.
+    const Handler& conhandler = handler;
+    typedef PairOfChunks<Handler::use_names> Chunk;
+    typedef decltype(handler.initialize()) State;
+
+    BlockTracker tracker(block_size);
+
+    run_pipeline<Chunk>(
+        pool,
+        handler,
+        [&](Chunk& curreads) -> bool {
+            int limit = tracker.next();
+            auto start = std::chrono::steady_clock::now();
+            bool finished = fill(curreads, limit);
+            tracker.record_parse(curreads.first.size(), curreads.first.bytes() + curreads.second.bytes(), seconds_since(start));
+            return finished;
+        },
+        [&](const Chunk& curreads, State& state) -> void {
+            auto start = std::chrono::steady_clock::now();
+            const auto& curreads1 = curreads.first;
+            const auto& curreads2 = curreads.second;
+            size_t nreads = curreads1.size();
+
+            if constexpr(!Handler::use_names) {
+                for (size_t b = 0; b < nreads; ++b) {
+                    conhandler.process(state, curreads1.get_sequence(b), curreads2.get_sequence(b));
+                }
+            } else {
+                for (size_t b = 0; b < nreads; ++b) {
+                    conhandler.process(
+                        state,
+                        curreads1.get_name(b), 
+                        curreads1.get_sequence(b),
+                        curreads2.get_name(b), 
+                        curreads2.get_sequence(b)
+                    );
                 }
             }
-        }
-    } catch (std::exception& e) {
-        // Mopping up any loose threads, so to speak.
-        for (int t = 0; t < num_threads; ++t) {
-            if (jobs[t].joinable()) {
-                jobs[t].join();
+            tracker.record_process(nreads, seconds_since(start));
+        },
+        [&](size_t blocks, double reduce_time) -> bool { return tracker.report(observer, blocks, reduce_time); }
+    );
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Perform a handler for each read in paired-end data, using an existing pool of worker threads.
+ * This allows the same workers to be reused across multiple calls, e.g., when processing several pairs of files.
+ *
+ * @tparam Handler A class that implements a handler for paired-end data, see the other `process_paired_end_data()` overloads for requirements.
+ * @tparam Parser Class template for parsing records from each input, see `process_single_end_data()`.
+ * @param input1 A `Reader` object containing data from the first FASTQ file in the pair.
+ * @param input2 A `Reader` object containing data from the second FASTQ file in the pair.
+ * @param handler Instance of the `Handler` class. 
+ * @param pool Pool of worker threads to use for processing.
+ * Note that an extra thread is always used to parse `input2` concurrently with `input1`.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read pair.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_paired_end_data(byteme::Reader* input1, byteme::Reader* input2, Handler& handler, ThreadPool& pool, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    check_window(window_start, window_end);
+    Parser<Handler::use_names> fastq1(input1, true);
+    Parser<Handler::use_names> fastq2(input2, true);
+
+    auto fill = [&](Parser<Handler::use_names>& fastq, ChunkOfReads<Handler::use_names>& curreads, int limit) -> bool {
+        for (int b = 0; b < limit; ++b) {
+            if (!fastq()) {
+                return true;
             }
+            add_parsed_read(fastq, curreads, window_start, window_end);
         }
-        throw;
-    }
+        return false;
+    };
 
-    return;
+    // Each mate file is parsed on its own thread, so paired-end parsing takes
+    // about as long as single-end parsing. This uses a dedicated worker that
+    // persists for the whole call, so no thread is created for each block,
+    // and it doesn't have to wait behind the processing tasks in 'pool'.
+    ThreadPool parser2(1);
+
+    run_paired_end_pipeline(
+        handler,
+        pool,
+        block_size,
+        observer,
+        [&](PairOfChunks<Handler::use_names>& curreads, int limit) -> bool {
+            bool finished2 = false;
+            auto parsed2 = parser2.submit([&]() -> void {
+                finished2 = fill(fastq2, curreads.second, limit);
+            });
+
+            // The mate 2 task refers to 'curreads', so it must finish before
+            // we leave this scope, whatever is thrown by the mate 1 parser.
+            bool finished1 = false;
+            try {
+                finished1 = fill(fastq1, curreads.first, limit);
+            } catch (...) {
+                parsed2.wait();
+                throw;
+            }
+            parsed2.get();
+
+            if (finished1 != finished2 || curreads.first.size() != curreads.second.size()) {
+                throw std::runtime_error("different number of reads in paired FASTQ files");
+            }
+            return finished1;
+        }
+    );
 }
 
 /**
  * Perform a handler for each read in paired-end data.
  *
  * @tparam Handler A class that implements a handler for paired-end data.
+ * @tparam Parser Class template for parsing records from each input, see `process_single_end_data()`.
  * @param input1 A `Reader` object containing data from the first FASTQ file in the pair.
  * @param input2 A `Reader` object containing data from the second FASTQ file in the pair.
  * @param handler Instance of the `Handler` class. 
  * @param num_threads Number of threads to use for processing.
- * @param block_size Number of reads in each thread.
+ * Note that an extra thread is always used to parse `input2` concurrently with `input1`.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * The same window is applied to both reads in each pair.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
  *
  * @return `handler.process()` is called on each read pair.
  * It is expected that the results are stored in `handler` for retrieval by the caller.
@@ -209,7 +764,14 @@ void process_single_end_data(byteme::Reader* input, Handler& handler, int num_th
  *   The idea is to store results in the state object for thread-safe execution.
  *   The state object should be default-constructible.
  * - `reduce(State& state)`: this should merge the results from the `state` object into the `Handler` instance.
- *   This will be called in a serial section and does not have to be thread-safe.
+ *   Calls to `reduce()` are serialized, but they may run concurrently with `process()` on other state objects.
+ *   Thus, `reduce()` should not modify anything that `process()` reads from the `Handler`, other than via the `reduce()` methods of the search classes (e.g., `SimpleBarcodeSearch::reduce()`), which are safe in this respect.
+ * - (optional) `flush(State& state)`: this should merge the per-read results (e.g., barcode counts) and the search caches from `state` into the `Handler` instance, and clear them from `state`.
+ *   If this method is present, each worker thread owns a single state object that persists across blocks, and the worker calls `flush()` on its state after processing each block,
+ *   while `reduce()` is only called once for each state object at the end of the run.
+ *   This avoids the cost of calling `initialize()` for every block, while still sharing the search caches across threads and keeping the caches in each state bounded by the size of a block.
+ *   Like `reduce()`, calls to `flush()` are serialized but may run concurrently with `process()` on other states.
+ *   Note that this assumes that the results of `reduce()` do not depend on the order in which reads are processed.
  *
  * The `Handler` should have a static `constexpr` variable `use_names`, indicating whether or not names should be passed to the `process()` method.
  *
@@ -224,124 +786,282 @@ void process_single_end_data(byteme::Reader* input, Handler& handler, int num_th
  *   `name1` and `name2` will contain pointers to the start and one-past-the-end of the read names.
  *   `seq1` and `seq2` will contain pointers to the start and one-past-the-end of the read sequences.
  */
-template<class Handler>
-void process_paired_end_data(byteme::Reader* input1, byteme::Reader* input2, Handler& handler, int num_threads = 1, int block_size = 100000) {
-    FastqReader fastq1(input1);
-    FastqReader fastq2(input2);
-    bool finished = false;
-
-    std::vector<ChunkOfReads<Handler::use_names> > reads1(num_threads), reads2(num_threads);
-    std::vector<std::thread> jobs(num_threads);
-    std::vector<decltype(handler.initialize())> states(num_threads);
-    std::vector<std::string> errs(num_threads);
-
-    auto join = [&](int i) -> void {
-        if (jobs[i].joinable()) {
-            jobs[i].join();
-            if (errs[i] != "") {
-                throw std::runtime_error(errs[i]);
-            }
-            handler.reduce(states[i]);
-            reads1[i].clear();
-            reads2[i].clear();
-        }
-    };
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_paired_end_data(byteme::Reader* input1, byteme::Reader* input2, Handler& handler, int num_threads = 1, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_paired_end_data<Handler, Parser>(input1, input2, handler, pool, block_size, window_start, window_end, observer);
+}
 
-    try {
-        while (!finished) {
-            for (int t = 0; t < num_threads; ++t) {
-                join(t);
-
-                bool finished1 = false;
-                {
-                    auto& curreads = reads1[t];
-                    for (int b = 0; b < block_size; ++b) {
-                        if (!fastq1()) {
-                            finished1 = true;
-                            break;
-                        }
-
-                        curreads.add_read_sequence(fastq1.get_sequence());
-                        if constexpr(Handler::use_names) {
-                            curreads.add_read_name(fastq1.get_name());
-                        }
-                    }
-                }
+/**
+ * Perform a handler for each read pair in interleaved paired-end data, using an existing pool of worker threads.
+ *
+ * @tparam Handler A class that implements a handler for paired-end data.
+ * @tparam Parser Class template for parsing records from `input`, see `process_single_end_data()`.
+ * @param input A `Reader` object containing data from an interleaved FASTQ file (or another format, depending on `Parser`),
+ * see the other interleaved `process_paired_end_data()` overload for details.
+ * @param handler Instance of the `Handler` class, see the other `process_paired_end_data()` overloads for requirements.
+ * @param pool Pool of worker threads to use for processing.
+ * @param block_size Number of read pairs in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read pair.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_paired_end_data(byteme::Reader* input, Handler& handler, ThreadPool& pool, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    check_window(window_start, window_end);
+    Parser<Handler::use_names> fastq(input, true);
 
-                bool finished2 = false;
-                {
-                    auto& curreads = reads2[t];
-                    for (int b = 0; b < block_size; ++b) {
-                        if (!fastq2()) {
-                            finished2 = true;
-                            break;
-                        }
-
-                        curreads.add_read_sequence(fastq2.get_sequence());
-                        if constexpr(Handler::use_names) {
-                            curreads.add_read_name(fastq2.get_name());
-                        }
-                    }
+    run_paired_end_pipeline(
+        handler,
+        pool,
+        block_size,
+        observer,
+        [&](PairOfChunks<Handler::use_names>& curreads, int limit) -> bool {
+            for (int b = 0; b < limit; ++b) {
+                if (!fastq()) {
+                    return true;
                 }
+                add_parsed_read(fastq, curreads.first, window_start, window_end);
 
-                if (finished1 != finished2 || reads1[t].size() != reads2[t].size()) {
-                    throw std::runtime_error("different number of reads in paired FASTQ files");
-                } else if (finished1) {
-                    finished = true;
+                if (!fastq()) {
+                    throw std::runtime_error("odd number of reads in interleaved FASTQ file");
                 }
+                add_parsed_read(fastq, curreads.second, window_start, window_end);
+            }
+            return false;
+        }
+    );
+}
+
+/**
+ * Perform a handler for each read pair in interleaved paired-end data, where the mates alternate within a single FASTQ file.
+ * This avoids the need to de-interleave the file before calling the other `process_paired_end_data()` overload.
+ *
+ * @tparam Handler A class that implements a handler for paired-end data.
+ * @tparam Parser Class template for parsing records from `input`, see `process_single_end_data()`.
+ * @param input A `Reader` object containing data from an interleaved FASTQ file (or another format, depending on `Parser`).
+ * Each odd-numbered record (first, third, etc.) is treated as the first read in a pair, and the following record is treated as its mate.
+ * @param handler Instance of the `Handler` class, see the other `process_paired_end_data()` overload for requirements.
+ * @param num_threads Number of threads to use for processing.
+ * @param block_size Number of read pairs in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * The same window is applied to both reads in each pair.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read pair.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler, template<bool> class Parser = FastqReader>
+void process_paired_end_data(byteme::Reader* input, Handler& handler, int num_threads = 1, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_paired_end_data<Handler, Parser>(input, handler, pool, block_size, window_start, window_end, observer);
+}
+
+/**
+ * @cond
+ */
+// Each "chunk" is just a range of read indices, as the reads are already in memory.
+struct RangeOfReads {
+    size_t start = 0, end = 0;
+    void clear() {}
+};
 
-                states[t] = handler.initialize();
-                jobs[t] = std::thread([&](int i) -> void {
-                    auto& state = states[i];
-                    const auto& curreads1 = reads1[i];
-                    const auto& curreads2 = reads2[i];
-                    size_t nreads = curreads1.size();
-
-                    try {
-                        if constexpr(!Handler::use_names) {
-                            for (size_t b = 0; b < nreads; ++b) {
-                                handler.process(state, curreads1.get_sequence(b), curreads2.get_sequence(b));
-                            }
-                        } else {
-                            for (size_t b = 0; b < nreads; ++b) {
-                                handler.process(
-                                    state,
-                                    curreads1.get_name(b), 
-                                    curreads1.get_sequence(b),
-                                    curreads2.get_name(b), 
-                                    curreads2.get_sequence(b)
-                                );
-                            }
-                        }
-                    } catch (std::exception& e) {
-                        errs[i] = std::string(e.what());
+inline void check_read_array(const ReadArray& reads, bool use_names) {
+    if (reads.number && (!reads.sequences || !reads.sequence_lengths)) {
+        throw std::runtime_error("sequences and their lengths must be supplied in the read array");
+    }
+    if (use_names && reads.number && (!reads.names || !reads.name_lengths)) {
+        throw std::runtime_error("names and their lengths must be supplied in the read array when 'Handler::use_names = true'");
+    }
+}
+
+inline size_t count_read_bytes(const ReadArray& reads, size_t start, size_t end, bool use_names, size_t window_start, size_t window_end) {
+    size_t nbytes = 0;
+    for (size_t r = start; r < end; ++r) {
+        auto len = reads.sequence_lengths[r];
+        nbytes += std::min(window_end, len) - std::min(window_start, len);
+        if (use_names) {
+            nbytes += reads.name_lengths[r];
+        }
+    }
+    return nbytes;
+}
+
+template<bool paired, class Handler>
+void process_read_arrays(const ReadArray& reads1, const ReadArray* reads2, Handler& handler, ThreadPool& pool, const BlockSize& block_size, size_t window_start, size_t window_end, const ProgressCallback& observer) {
+    check_window(window_start, window_end);
+    check_read_array(reads1, Handler::use_names);
+    if (reads2) {
+        check_read_array(*reads2, Handler::use_names);
+        if (reads1.number != reads2->number) {
+            throw std::runtime_error("different number of reads in paired read arrays");
+        }
+    }
+
+    size_t num_reads = reads1.number;
+    if (num_reads == 0) {
+        return;
+    }
+
+    // Safety measure to enforce const-ness within each thread.
+    const Handler& conhandler = handler;
+    typedef decltype(handler.initialize()) State;
+    BlockTracker tracker(block_size);
+    size_t next_read = 0;
+
+    run_pipeline<RangeOfReads>(
+        pool,
+        handler,
+        [&](RangeOfReads& range) -> bool {
+            // No parsing is required, but the bytes are still recorded for byte-budgeted blocks and progress reports.
+            auto start = std::chrono::steady_clock::now();
+            size_t limit = tracker.next();
+            range.start = next_read;
+            range.end = next_read + std::min(limit, num_reads - next_read);
+            next_read = range.end;
+
+            size_t nbytes = count_read_bytes(reads1, range.start, range.end, Handler::use_names, window_start, window_end);
+            if (reads2) {
+                nbytes += count_read_bytes(*reads2, range.start, range.end, Handler::use_names, window_start, window_end);
+            }
+            tracker.record_parse(range.end - range.start, nbytes, seconds_since(start));
+            return next_read == num_reads;
+        },
+        [&](const RangeOfReads& range, State& state) -> void {
+            auto start = std::chrono::steady_clock::now();
+            if constexpr(!paired) {
+                for (size_t r = range.start; r < range.end; ++r) {
+                    auto seq = restrict_to_window(reads1.get_sequence(r), window_start, window_end);
+                    if constexpr(!Handler::use_names) {
+                        conhandler.process(state, seq);
+                    } else {
+                        conhandler.process(state, reads1.get_name(r), seq);
                     }
-                }, t);
-
-                if (finished) {
-                    // We won't get a future iteration to join the previous threads
-                    // that we kicked off, so we do it now.
-                    for (int u = 0; u < num_threads; ++u) {
-                        auto pos = (u + t + 1) % num_threads;
-                        join(pos);
+                }
+            } else {
+                for (size_t r = range.start; r < range.end; ++r) {
+                    auto seq1 = restrict_to_window(reads1.get_sequence(r), window_start, window_end);
+                    auto seq2 = restrict_to_window(reads2->get_sequence(r), window_start, window_end);
+                    if constexpr(!Handler::use_names) {
+                        conhandler.process(state, seq1, seq2);
+                    } else {
+                        conhandler.process(state, reads1.get_name(r), seq1, reads2->get_name(r), seq2);
                     }
-                    break;
                 }
             }
-        }
-    } catch (std::exception& e) {
-        // Mopping up any loose threads, so to speak.
-        for (int t = 0; t < num_threads; ++t) {
-            if (jobs[t].joinable()) {
-                jobs[t].join();
-            }
-        }
-        throw;
-    }
+            tracker.record_process(range.end - range.start, seconds_since(start));
+        },
+        [&](size_t blocks, double reduce_time) -> bool { return tracker.report(observer, blocks, reduce_time); }
+    );
+}
+/**
+ * @endcond
+ */
 
-    return;
+/**
+ * Perform a handler for each read in single-end data that is already in memory as an array of sequences, using an existing pool of worker threads.
+ * This avoids serializing the reads into FASTQ text for `process_single_end_data()`, e.g., when the reads are supplied by an R or Python front-end.
+ * Reads are passed to the handler directly from the supplied pointers, so no copies are made.
+ *
+ * @tparam Handler A class that implements a handler for single-end data, see `process_single_end_data()` for requirements.
+ *
+ * @param reads View into the read sequences (and names, if `Handler::use_names = true`).
+ * @param handler Instance of the `Handler` class.
+ * @param pool Pool of worker threads to use for processing.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler>
+void process_single_end_reads(const ReadArray& reads, Handler& handler, ThreadPool& pool, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    process_read_arrays<false>(reads, static_cast<const ReadArray*>(NULL), handler, pool, block_size, window_start, window_end, observer);
+}
+
+/**
+ * Perform a handler for each read in single-end data that is already in memory as an array of sequences.
+ *
+ * @tparam Handler A class that implements a handler for single-end data, see `process_single_end_data()` for requirements.
+ *
+ * @param reads View into the read sequences (and names, if `Handler::use_names = true`).
+ * @param handler Instance of the `Handler` class.
+ * @param num_threads Number of threads to use for processing.
+ * @param block_size Number of reads in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler>
+void process_single_end_reads(const ReadArray& reads, Handler& handler, int num_threads = 1, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_single_end_reads(reads, handler, pool, block_size, window_start, window_end, observer);
+}
+
+/**
+ * Perform a handler for each read pair in paired-end data that is already in memory as arrays of sequences, using an existing pool of worker threads.
+ * This avoids serializing the reads into FASTQ text for `process_paired_end_data()`.
+ *
+ * @tparam Handler A class that implements a handler for paired-end data, see `process_paired_end_data()` for requirements.
+ *
+ * @param reads1 View into the first read in each pair.
+ * @param reads2 View into the second read in each pair.
+ * This should contain the same number of reads as `reads1`.
+ * @param handler Instance of the `Handler` class.
+ * @param pool Pool of worker threads to use for processing.
+ * @param block_size Number of read pairs in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * The same window is applied to both reads in each pair.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read pair.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler>
+void process_paired_end_reads(const ReadArray& reads1, const ReadArray& reads2, Handler& handler, ThreadPool& pool, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    process_read_arrays<true>(reads1, &reads2, handler, pool, block_size, window_start, window_end, observer);
 }
 
+/**
+ * Perform a handler for each read pair in paired-end data that is already in memory as arrays of sequences.
+ *
+ * @tparam Handler A class that implements a handler for paired-end data, see `process_paired_end_data()` for requirements.
+ *
+ * @param reads1 View into the first read in each pair.
+ * @param reads2 View into the second read in each pair.
+ * This should contain the same number of reads as `reads1`.
+ * @param handler Instance of the `Handler` class.
+ * @param num_threads Number of threads to use for processing.
+ * @param block_size Number of read pairs in each task, or a `BlockSize` instance for byte-budgeted or adaptive block sizing.
+ * @param window_start Position on each read at which to start the window, see `process_single_end_data()`.
+ * @param window_end Position on each read at which to end the window, see `process_single_end_data()`.
+ * The same window is applied to both reads in each pair.
+ * @param observer Callback to report progress after each block, see `ProgressCallback` for details.
+ * If empty, no progress is reported.
+ *
+ * @return `handler.process()` is called on each read pair.
+ * It is expected that the results are stored in `handler` for retrieval by the caller.
+ */
+template<class Handler>
+void process_paired_end_reads(const ReadArray& reads1, const ReadArray& reads2, Handler& handler, int num_threads = 1, const BlockSize& block_size = BlockSize(), size_t window_start = 0, size_t window_end = std::numeric_limits<size_t>::max(), const ProgressCallback& observer = ProgressCallback()) {
+    ThreadPool pool(num_threads);
+    process_paired_end_reads(reads1, reads2, handler, pool, block_size, window_start, window_end, observer);
+}
 
 }
 
@@ -0,0 +1,174 @@
+#ifndef KAORI_SERIALIZE_HPP
+#define KAORI_SERIALIZE_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <stdexcept>
+
+/**
+ * @file serialize.hpp
+ *
+ * @brief Serialize the results of a handler.
+ *
+ * Each handler provides a `write_results()` method to serialize its results to a `std::ostream`, 
+ * and a `merge_results()` method to add serialized results from a `std::istream` to an existing instance.
+ * This is typically used to combine partial results from different shards of a file, see `find_fastq_shard()`;
+ * or to deserialize results, by calling `merge_results()` on a newly constructed handler.
+ *
+ * Results are written as whitespace-separated text, so that they can be moved between machines regardless of endianness or integer width.
+ * Each set of results starts with a header containing the handler type and a format version.
+ * `merge_results()` should be called on a handler constructed with the same arguments as the one that wrote the results;
+ * an error is raised if the type or version does not match, or if the results were generated from a barcode pool of a different size.
+ *
+ * `merge_results()` parses all of the serialized results before modifying the handler.
+ * If an error is raised, e.g., due to truncated or incompatible input, the handler is left unchanged.
+ */
+
+namespace kaori {
+
+/**
+ * @cond
+ */
+inline void write_results_header(std::ostream& out, const char* type) {
+    out << "kaori::" << type << " 1\n";
+}
+
+inline void check_results_stream(std::istream& in, const char* type) {
+    if (!in) {
+        throw std::runtime_error(std::string("failed to read serialized results for '") + type + "'");
+    }
+}
+
+inline void read_results_header(std::istream& in, const char* type) {
+    std::string found;
+    int version = 0;
+    in >> found >> version;
+    check_results_stream(in, type);
+    if (found != std::string("kaori::") + type || version != 1) {
+        throw std::runtime_error(std::string("serialized results are not from a compatible '") + type + "' handler");
+    }
+}
+
+template<typename Count>
+void write_results_value(std::ostream& out, Count value) {
+    out << +value << "\n"; // promoting so that small integer types aren't written as characters.
+}
+
+template<typename Count>
+Count read_results_value(std::istream& in, const char* type) {
+    decltype(+Count()) value = 0;
+    in >> value;
+    check_results_stream(in, type);
+    return value;
+}
+
+template<typename Count>
+void write_results_counts(std::ostream& out, const std::vector<Count>& counts) {
+    out << counts.size() << "\n";
+    for (auto c : counts) {
+        write_results_value(out, c);
+    }
+}
+
+template<typename Count>
+std::vector<Count> read_results_counts(std::istream& in, size_t expected, const char* type) {
+    size_t n = 0;
+    in >> n;
+    check_results_stream(in, type);
+    if (n != expected) {
+        throw std::runtime_error(std::string("serialized results for '") + type + "' have a different number of barcodes");
+    }
+
+    std::vector<Count> counts(n);
+    for (auto& c : counts) {
+        c = read_results_value<Count>(in, type);
+    }
+    return counts;
+}
+
+template<size_t N>
+void write_results_combinations(std::ostream& out, const std::vector<std::array<int, N> >& combinations) {
+    out << N << " " << combinations.size() << "\n";
+    for (const auto& current : combinations) {
+        for (size_t i = 0; i < N; ++i) {
+            out << current[i] << (i + 1 == N ? "\n" : " ");
+        }
+    }
+}
+
+template<size_t N>
+std::vector<std::array<int, N> > read_results_combinations(std::istream& in, const char* type) {
+    size_t dim = 0, n = 0;
+    in >> dim >> n;
+    check_results_stream(in, type);
+    if (dim != N) {
+        throw std::runtime_error(std::string("serialized results for '") + type + "' have a different number of variable regions");
+    }
+
+    // Not reserving 'n' up front, in case the count itself is corrupted.
+    std::vector<std::array<int, N> > combinations;
+    for (size_t c = 0; c < n; ++c) {
+        std::array<int, N> current;
+        for (auto& x : current) {
+            in >> x;
+        }
+        check_results_stream(in, type);
+        combinations.push_back(current);
+    }
+    return combinations;
+}
+
+// Results are parsed into one of these before being added to the handler, so
+// that a failed merge leaves the handler untouched.
+template<typename Count>
+struct ParsedCounts {
+    std::vector<Count> counts;
+    Count total = 0;
+
+    void add_to(std::vector<Count>& all_counts, Count& all_total) const {
+        for (size_t i = 0, end = counts.size(); i < end; ++i) {
+            all_counts[i] += counts[i];
+        }
+        all_total += total;
+    }
+};
+
+template<typename Count>
+ParsedCounts<Count> read_results_parsed_counts(std::istream& in, size_t expected, const char* type) {
+    ParsedCounts<Count> output;
+    read_results_header(in, type);
+    output.counts = read_results_counts<Count>(in, expected, type);
+    output.total = read_results_value<Count>(in, type);
+    return output;
+}
+
+template<size_t N, typename Count, size_t num_totals>
+struct ParsedCombinations {
+    std::vector<std::array<int, N> > combinations;
+    std::array<Count, num_totals> totals{};
+
+    void add_to(std::vector<std::array<int, N> >& all_combinations) const {
+        all_combinations.insert(all_combinations.end(), combinations.begin(), combinations.end());
+    }
+};
+
+template<size_t N, typename Count, size_t num_totals>
+ParsedCombinations<N, Count, num_totals> read_results_parsed_combinations(std::istream& in, const char* type) {
+    ParsedCombinations<N, Count, num_totals> output;
+    read_results_header(in, type);
+    output.combinations = read_results_combinations<N>(in, type);
+    for (auto& t : output.totals) {
+        t = read_results_value<Count>(in, type);
+    }
+    return output;
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+#include "kaori/BamReader.hpp"
+#include "kaori/process_data.hpp"
+#include "byteme/RawBufferReader.hpp"
+#include "byteme/RawFileReader.hpp"
+#include <fstream>
+#include <cstdint>
+
+class BamReaderTest : public testing::TestWithParam<int> {
+protected:
+    static void add_int(std::string& out, int32_t val, int nbytes = 4) {
+        uint32_t x = val;
+        for (int i = 0; i < nbytes; ++i) {
+            out += static_cast<char>((x >> (8 * i)) & 0xff);
+        }
+    }
+
+    static std::string create_header() {
+        std::string out = "BAM\1";
+        std::string text = "@HD\tVN:1.6\tSO:unknown\n";
+        add_int(out, text.size());
+        out += text;
+        add_int(out, 1); // one reference, for good measure.
+        add_int(out, 5);
+        out += std::string("chr1") + '\0';
+        add_int(out, 1000);
+        return out;
+    }
+
+    static std::string create_record(const std::string& name, const std::string& seq, int flag = 4, int ncigar = 0) {
+        std::string body;
+        add_int(body, -1); // refID
+        add_int(body, -1); // pos
+        add_int(body, name.size() + 1, 1);
+        add_int(body, 0, 1); // mapq
+        add_int(body, 4680, 2); // bin
+        add_int(body, ncigar, 2);
+        add_int(body, flag, 2);
+        add_int(body, seq.size());
+        add_int(body, -1); // next refID
+        add_int(body, -1); // next pos
+        add_int(body, 0); // tlen
+        body += name + '\0';
+        for (int c = 0; c < ncigar; ++c) {
+            add_int(body, (10 << 4)); // 10M
+        }
+
+        std::string codes = "=ACMGRSVTWYHKDBN";
+        for (size_t i = 0; i < seq.size(); i += 2) {
+            int first = codes.find(seq[i]);
+            int second = (i + 1 < seq.size() ? codes.find(seq[i + 1]) : 0);
+            body += static_cast<char>((first << 4) | second);
+        }
+        body += std::string(seq.size(), static_cast<char>(0xff)); // quality
+        body += "XYZhello"; // some random tag data.
+        body += '\0';
+
+        std::string out;
+        add_int(out, body.size());
+        return out + body;
+    }
+
+    static std::string reverse_complement(const std::string& seq) {
+        std::string out(seq.rbegin(), seq.rend());
+        for (auto& x : out) {
+            switch (x) {
+                case 'A': x = 'T'; break;
+                case 'C': x = 'G'; break;
+                case 'G': x = 'C'; break;
+                case 'T': x = 'A'; break;
+            }
+        }
+        return out;
+    }
+};
+
+TEST_P(BamReaderTest, Basic) {
+    std::vector<std::string> names, seqs;
+    std::string contents = create_header();
+    for (size_t i = 0; i < 500; ++i) {
+        names.push_back("READ_" + std::to_string(i));
+        std::string current;
+        for (size_t j = 0; j < i % 30 + 1; ++j) { // mix of odd and even lengths.
+            current += "ACGTN"[(i + j * 3) % 5];
+        }
+        seqs.push_back(current);
+
+        if (i % 3 == 0) {
+            // Reverse-strand alignment that should be flipped back.
+            contents += create_record(names.back(), reverse_complement(current), 0x10, 1);
+        } else {
+            contents += create_record(names.back(), current);
+        }
+
+        if (i % 7 == 0) {
+            contents += create_record("SECONDARY", "AAAA", 0x100);
+            contents += create_record("SUPPLEMENTARY", "CCCC", 0x800);
+        }
+    }
+
+    std::string path = "TEST_reader.bam";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    {
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::BamReader fq(&reader);
+        for (size_t i = 0; i < names.size(); ++i) {
+            ASSERT_TRUE(fq());
+            const auto& name = fq.get_name();
+            EXPECT_EQ(std::string(name.begin(), name.end()), names[i]);
+            const auto& seq = fq.get_sequence();
+            EXPECT_EQ(std::string(seq.begin(), seq.end()), seqs[i]);
+        }
+        EXPECT_FALSE(fq());
+    }
+
+    {
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::BamReader<false> fq(&reader, true);
+        for (size_t i = 0; i < names.size(); ++i) {
+            ASSERT_TRUE(fq());
+            auto name = fq.get_name_view();
+            EXPECT_EQ(name.first, name.second);
+            auto seq = fq.get_sequence_view();
+            EXPECT_EQ(std::string(seq.first, seq.second), seqs[i]);
+        }
+        EXPECT_FALSE(fq());
+    }
+
+    {
+        // Decoding directly from the packed bytes, with and without windows.
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::BamReader fq(&reader, true);
+        std::vector<char> buffer;
+        for (size_t i = 0; i < names.size(); ++i) {
+            ASSERT_TRUE(fq());
+            auto name = fq.get_name_view();
+            EXPECT_EQ(std::string(name.first, name.second), names[i]);
+
+            buffer.clear();
+            fq.append_sequence(buffer);
+            EXPECT_EQ(std::string(buffer.begin(), buffer.end()), seqs[i]);
+
+            buffer.clear();
+            fq.append_sequence(buffer, 2, 7);
+            EXPECT_EQ(std::string(buffer.begin(), buffer.end()), seqs[i].substr(std::min(seqs[i].size(), static_cast<size_t>(2)), 5));
+
+            // Vector accessors also work with views.
+            const auto& vseq = fq.get_sequence();
+            EXPECT_EQ(std::string(vseq.begin(), vseq.end()), seqs[i]);
+            const auto& vname = fq.get_name();
+            EXPECT_EQ(std::string(vname.begin(), vname.end()), names[i]);
+        }
+        EXPECT_FALSE(fq());
+    }
+}
+
+TEST_P(BamReaderTest, Errors) {
+    {
+        std::string contents = create_header();
+        contents[3] = 2;
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(contents.c_str()), contents.size());
+        EXPECT_ANY_THROW({
+            try {
+                kaori::BamReader fq(&reader);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("magic") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    {
+        std::string contents = create_header() + create_record("FOO", "ACGT") + create_record("BAR", "ACGT");
+        contents.resize(contents.size() - 5);
+
+        std::string path = "TEST_reader.bam";
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << contents;
+        }
+
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::BamReader fq(&reader);
+        EXPECT_TRUE(fq());
+        EXPECT_ANY_THROW({
+            try {
+                fq();
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("BAM record 2") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+}
+
+class BamCollector {
+public:
+    struct State {
+        std::vector<std::string> reads1, reads2;
+    };
+
+    void process(State& state, const std::pair<const char*, const char*>& x1, const std::pair<const char*, const char*>& x2) const {
+        state.reads1.emplace_back(x1.first, x1.second);
+        state.reads2.emplace_back(x2.first, x2.second);
+    }
+
+    State initialize() const {
+        return State();
+    }
+
+    void reduce(State& x) {
+        collected1.insert(collected1.end(), x.reads1.begin(), x.reads1.end());
+        collected2.insert(collected2.end(), x.reads2.begin(), x.reads2.end());
+    }
+
+    static constexpr bool use_names = false;
+
+    std::vector<std::string> collected1, collected2;
+};
+
+TEST_P(BamReaderTest, InterleavedPairs) {
+    std::vector<std::string> seqs1, seqs2;
+    std::string contents = create_header();
+    for (size_t i = 0; i < 200; ++i) {
+        seqs1.emplace_back(i % 20 + 5, "ACGT"[i % 4]);
+        seqs2.emplace_back(i % 15 + 5, "ACGT"[(i + 1) % 4]);
+        contents += create_record("READ_" + std::to_string(i), seqs1.back(), 0x4 | 0x1 | 0x40);
+        contents += create_record("READ_" + std::to_string(i), seqs2.back(), 0x4 | 0x1 | 0x80);
+    }
+
+    std::string path = "TEST_reader.bam";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    byteme::RawFileReader reader(path, GetParam());
+    BamCollector task;
+    kaori::process_paired_end_data<BamCollector, kaori::BamReader>(&reader, task, 2, 33);
+    EXPECT_EQ(task.collected1, seqs1);
+    EXPECT_EQ(task.collected2, seqs2);
+}
+
+class BamSingleCollector {
+public:
+    struct State {
+        std::vector<std::string> reads;
+    };
+
+    void process(State& state, const std::pair<const char*, const char*>& x) const {
+        state.reads.emplace_back(x.first, x.second);
+    }
+
+    State initialize() const {
+        return State();
+    }
+
+    void reduce(State& x) {
+        collected.insert(collected.end(), x.reads.begin(), x.reads.end());
+    }
+
+    static constexpr bool use_names = false;
+
+    std::vector<std::string> collected;
+};
+
+TEST_P(BamReaderTest, Window) {
+    std::vector<std::string> expected;
+    std::string contents = create_header();
+    for (size_t i = 0; i < 200; ++i) {
+        std::string current;
+        for (size_t j = 0; j < i % 20 + 1; ++j) {
+            current += "ACGTN"[(i + j) % 5];
+        }
+        if (i % 2) {
+            contents += create_record("READ_" + std::to_string(i), reverse_complement(current), 0x10);
+        } else {
+            contents += create_record("READ_" + std::to_string(i), current);
+        }
+        expected.push_back(current.substr(std::min(current.size(), static_cast<size_t>(3)), 7));
+    }
+
+    std::string path = "TEST_reader.bam";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    byteme::RawFileReader reader(path, GetParam());
+    BamSingleCollector task;
+    kaori::process_single_end_data<BamSingleCollector, kaori::BamReader>(&reader, task, 1, 33, 3, 10);
+    EXPECT_EQ(task.collected, expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BamReader,
+    BamReaderTest,
+    ::testing::Values(5, 10, 50, 1000)
+);
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "kaori/BlockSize.hpp"
+
+TEST(BlockSize, Fixed) {
+    kaori::BlockSize spec(500);
+    kaori::BlockTracker tracker(spec);
+    EXPECT_EQ(tracker.next(), 500);
+    tracker.record_parse(500, 100000, 1);
+    tracker.record_process(500, 1);
+    EXPECT_EQ(tracker.next(), 500);
+
+    EXPECT_ANY_THROW({
+        try {
+            kaori::BlockSize(0);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("positive") != std::string::npos);
+            throw e;
+        }
+    });
+}
+
+TEST(BlockSize, MaxBytes) {
+    kaori::BlockTracker tracker(kaori::BlockSize(1000).set_max_bytes(5000).set_min_reads(10));
+    EXPECT_EQ(tracker.next(), 10); // first block is a probe.
+
+    tracker.record_parse(10, 1000, 0);
+    EXPECT_EQ(tracker.next(), 50);
+
+    // Capped at the maximum number of reads.
+    tracker.record_parse(1000, 0, 0);
+    EXPECT_EQ(tracker.next(), 1000);
+
+    // Always at least one read.
+    kaori::BlockTracker tracker2(kaori::BlockSize(1000).set_max_bytes(10).set_min_reads(10));
+    tracker2.record_parse(10, 10000, 0);
+    EXPECT_EQ(tracker2.next(), 1);
+}
+
+TEST(BlockSize, Adaptive) {
+    kaori::BlockTracker tracker(kaori::BlockSize(100000).set_adaptive().set_target_time(0.1).set_min_reads(100));
+    EXPECT_EQ(tracker.next(), 100);
+
+    // Still using the minimum until we have timings for both steps.
+    tracker.record_parse(100, 1000, 0.0001);
+    EXPECT_EQ(tracker.next(), 100);
+
+    // Processing is the bottleneck at 0.0001 seconds per read.
+    tracker.record_process(100, 0.01);
+    EXPECT_NEAR(tracker.next(), 1000, 1);
+
+    // Parsing is the bottleneck at 0.00001 seconds per read.
+    kaori::BlockTracker tracker2(kaori::BlockSize(100000).set_adaptive().set_target_time(0.1).set_min_reads(100));
+    tracker2.record_parse(100, 1000, 0.001);
+    tracker2.record_process(100, 0.0001);
+    EXPECT_NEAR(tracker2.next(), 10000, 1);
+
+    // Capped at both ends.
+    kaori::BlockTracker tracker3(kaori::BlockSize(5000).set_adaptive().set_target_time(0.1).set_min_reads(100));
+    tracker3.record_parse(100, 1000, 0);
+    tracker3.record_process(100, 0);
+    EXPECT_EQ(tracker3.next(), 5000);
+
+    kaori::BlockTracker tracker4(kaori::BlockSize(5000).set_adaptive().set_target_time(0.1).set_min_reads(100));
+    tracker4.record_parse(100, 1000, 1);
+    tracker4.record_process(100, 1);
+    EXPECT_EQ(tracker4.next(), 100);
+}
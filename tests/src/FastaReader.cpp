@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "kaori/FastaReader.hpp"
+#include "kaori/process_data.hpp"
+#include "byteme/RawBufferReader.hpp"
+#include "byteme/RawFileReader.hpp"
+#include <fstream>
+
+TEST(FastaReader, Single) {
+    std::string buffer = ">FOO\nACGT"; // check it works without a terminating newline.
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer.c_str()), buffer.size());
+    kaori::FastaReader fq(&reader);
+
+    EXPECT_TRUE(fq());
+    const auto& name = fq.get_name();
+    EXPECT_EQ(std::string(name.begin(), name.end()), "FOO");
+    const auto& seq = fq.get_sequence();
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "ACGT");
+
+    EXPECT_FALSE(fq());
+}
+
+TEST(FastaReader, MultipleEntries) {
+    std::string buffer = ">FOO and more info\nACGT\nAAAA\n\n>WHEE\n>BLAH\nTG\nCA\n>STUFF";
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer.c_str()), buffer.size());
+    kaori::FastaReader fq(&reader);
+
+    EXPECT_TRUE(fq());
+    const auto& name = fq.get_name();
+    EXPECT_EQ(std::string(name.begin(), name.end()), "FOO");
+    const auto& seq = fq.get_sequence();
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "ACGTAAAA");
+
+    EXPECT_TRUE(fq());
+    EXPECT_EQ(std::string(name.begin(), name.end()), "WHEE");
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "");
+
+    EXPECT_TRUE(fq());
+    EXPECT_EQ(std::string(name.begin(), name.end()), "BLAH");
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "TGCA");
+
+    EXPECT_TRUE(fq());
+    EXPECT_EQ(std::string(name.begin(), name.end()), "STUFF");
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "");
+
+    EXPECT_FALSE(fq());
+}
+
+TEST(FastaReader, Errors) {
+    std::string buffer = "@FOO\nACGT\n";
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer.c_str()), buffer.size());
+
+    EXPECT_ANY_THROW({
+        try {
+            kaori::FastaReader fq(&reader);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("first line") != std::string::npos);
+            throw e;
+        }
+    });
+}
+
+class FastaReaderFileTest : public testing::TestWithParam<int> {};
+
+TEST_P(FastaReaderFileTest, StressTest) {
+    std::string path = "TEST_reader.fasta";
+    {
+        std::ofstream out(path);
+        for (size_t i = 0; i < 1000; ++i) {
+            out << ">" << "READ_" << i << " extra\n";
+            out << "AAAAAAAAAAAAAAAaaaaaaaaaaaaaa\n";
+            out << "CCCCCCCCCCCCCCCcccccccccccccc\n";
+        }
+    }
+
+    std::string ref = "AAAAAAAAAAAAAAAaaaaaaaaaaaaaa";
+    ref += "CCCCCCCCCCCCCCCcccccccccccccc";
+
+    {
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::FastaReader fq(&reader);
+        for (size_t i = 0; i < 1000; ++i) {
+            EXPECT_TRUE(fq());
+            const auto& name = fq.get_name();
+            EXPECT_EQ(std::string(name.begin(), name.end()), "READ_" + std::to_string(i));
+            const auto& seq = fq.get_sequence();
+            EXPECT_EQ(std::string(seq.begin(), seq.end()), ref);
+        }
+        EXPECT_FALSE(fq());
+    }
+
+    {
+        byteme::RawFileReader reader(path, GetParam());
+        kaori::FastaReader<false> fq(&reader, true);
+        for (size_t i = 0; i < 1000; ++i) {
+            EXPECT_TRUE(fq());
+            auto name = fq.get_name_view();
+            EXPECT_EQ(name.first, name.second);
+            auto seq = fq.get_sequence_view();
+            EXPECT_EQ(std::string(seq.first, seq.second), ref);
+        }
+        EXPECT_FALSE(fq());
+    }
+}
+
+class FastaCollector {
+public:
+    struct State {
+        std::vector<std::string> reads;
+    };
+
+    void process(State& state, const std::pair<const char*, const char*>& x) const {
+        state.reads.emplace_back(x.first, x.second);
+    }
+
+    State initialize() const {
+        return State();
+    }
+
+    void reduce(State& x) {
+        collected_reads.insert(collected_reads.end(), x.reads.begin(), x.reads.end());
+    }
+
+    static constexpr bool use_names = false;
+
+    std::vector<std::string> collected_reads;
+};
+
+TEST_P(FastaReaderFileTest, ProcessData) {
+    std::string path = "TEST_reader.fasta";
+    std::vector<std::string> expected;
+    {
+        std::ofstream out(path);
+        for (size_t i = 0; i < 1000; ++i) {
+            expected.emplace_back(i % 20 + 5, "ACGT"[i % 4]);
+            out << ">" << "READ_" << i << "\n" << expected.back() << "\n";
+        }
+    }
+
+    byteme::RawFileReader reader(path, GetParam());
+    FastaCollector task;
+    kaori::process_single_end_data<FastaCollector, kaori::FastaReader>(&reader, task, 3, 77);
+    EXPECT_EQ(task.collected_reads, expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    FastaReader,
+    FastaReaderFileTest,
+    ::testing::Values(5, 10, 50, 1000)
+);
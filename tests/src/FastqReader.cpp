@@ -113,6 +113,100 @@ TEST(BasicTests, Errors) {
     }
 }
 
+TEST(BasicTests, Views) {
+    std::string buffer = "@FOO and more info\nACGT\n+\n!!!!\n@WHEE\nTG\nCA\n+asdasd\naa\naa\n";
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer.c_str()), buffer.size());
+    kaori::FastqReader fq(&reader, true);
+
+    EXPECT_TRUE(fq());
+    auto name = fq.get_name_view();
+    EXPECT_EQ(std::string(name.first, name.second), "FOO");
+    auto seq = fq.get_sequence_view();
+    EXPECT_EQ(std::string(seq.first, seq.second), "ACGT");
+    EXPECT_TRUE(seq.first >= buffer.c_str() && seq.second <= buffer.c_str() + buffer.size()); // no copy.
+
+    EXPECT_TRUE(fq());
+    name = fq.get_name_view();
+    EXPECT_EQ(std::string(name.first, name.second), "WHEE");
+    seq = fq.get_sequence_view();
+    EXPECT_EQ(std::string(seq.first, seq.second), "TGCA"); // copied, as it spans multiple lines.
+
+    EXPECT_FALSE(fq());
+}
+
+TEST(BasicTests, ViewsWithVectors) {
+    // Vector accessors still work with views, by copying on request.
+    std::string buffer = "@FOO and more info\nACGT\n+\n!!!!\n@WHEE\nTG\nCA\n+asdasd\naa\naa\n";
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(buffer.c_str()), buffer.size());
+    kaori::FastqReader fq(&reader, true);
+
+    EXPECT_TRUE(fq());
+    const auto& name = fq.get_name();
+    EXPECT_EQ(std::string(name.begin(), name.end()), "FOO");
+    const auto& seq = fq.get_sequence();
+    EXPECT_EQ(std::string(seq.begin(), seq.end()), "ACGT");
+    auto view = fq.get_sequence_view();
+    EXPECT_EQ(std::string(view.first, view.second), "ACGT");
+
+    EXPECT_TRUE(fq());
+    const auto& name2 = fq.get_name();
+    EXPECT_EQ(std::string(name2.begin(), name2.end()), "WHEE");
+    const auto& seq2 = fq.get_sequence();
+    EXPECT_EQ(std::string(seq2.begin(), seq2.end()), "TGCA");
+
+    EXPECT_FALSE(fq());
+}
+
+TEST(FindNextRecord, Basic) {
+    std::string buffer = "@FOO\nACGT\n+\n@!!!\n@WHEE\nTGCA\n+asdasd\n+aaa\n@BLAH\nAAAA\n+\n!!!!\n";
+    auto next = [&](size_t pos) -> size_t {
+        return kaori::find_next_fastq_record(buffer.c_str(), buffer.size(), pos);
+    };
+
+    size_t second = buffer.find("@WHEE"), third = buffer.find("@BLAH");
+    EXPECT_EQ(next(0), 0);
+    EXPECT_EQ(next(1), second); // skips the quality string starting with '@'.
+    EXPECT_EQ(next(buffer.find("@!!!")), second);
+    EXPECT_EQ(next(second), second);
+    EXPECT_EQ(next(second + 1), third);
+    EXPECT_EQ(next(third), third);
+    EXPECT_EQ(next(third + 1), buffer.size());
+    EXPECT_EQ(next(buffer.size()), buffer.size());
+    EXPECT_EQ(next(buffer.size() + 10), buffer.size());
+}
+
+TEST(FindFastqShard, Basic) {
+    std::string buffer = "@FOO\nACGT\n+\n@!!!\n@WHEE\nTGCA\n+asdasd\n+aaa\n@BLAH\nAAAA\n+\n!!!!\n@YAY\nCCCC\n+\n####\n";
+
+    // Shards are contiguous and cover the entire buffer.
+    for (size_t nshards = 1; nshards <= 10; ++nshards) {
+        size_t last = 0;
+        for (size_t s = 0; s < nshards; ++s) {
+            auto range = kaori::find_fastq_shard(buffer.c_str(), buffer.size(), s, nshards);
+            EXPECT_EQ(range.first, last);
+            EXPECT_LE(range.first, range.second);
+            if (range.second != buffer.size()) {
+                EXPECT_EQ(buffer[range.second], '@');
+            }
+            last = range.second;
+        }
+        EXPECT_EQ(last, buffer.size());
+    }
+
+    auto halves = kaori::find_fastq_shard(buffer.c_str(), buffer.size(), 1, 2);
+    EXPECT_EQ(halves.first, buffer.find("@BLAH"));
+    EXPECT_EQ(halves.second, buffer.size());
+
+    EXPECT_ANY_THROW({
+        try {
+            kaori::find_fastq_shard(buffer.c_str(), buffer.size(), 2, 2);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("shard index") != std::string::npos);
+            throw e;
+        }
+    });
+}
+
 class FastqReaderFileTest : public testing::TestWithParam<int> {};
 
 TEST_P(FastqReaderFileTest, LongStrings) {
@@ -168,6 +262,56 @@ TEST_P(FastqReaderFileTest, StressTest) {
     EXPECT_FALSE(fq());
 }
 
+TEST_P(FastqReaderFileTest, StressTestViews) {
+    std::string path = "TEST_reader.fastq";
+    {
+        std::ofstream out(path);
+        for (size_t i = 0; i < 1000; ++i) {
+            out << "@" << "READ_" << i << " extra\n";
+            out << "ACGTACGTACGTACGTACGTacgtacgtacg\n";
+            out << "+" << "\n";
+            out << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+        }
+    }
+    byteme::RawFileReader reader(path, GetParam());
+    kaori::FastqReader fq(&reader, true);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(fq());
+        auto name = fq.get_name_view();
+        EXPECT_EQ(std::string(name.first, name.second), "READ_" + std::to_string(i));
+        auto seq = fq.get_sequence_view();
+        EXPECT_EQ(std::string(seq.first, seq.second), "ACGTACGTACGTACGTACGTacgtacgtacg");
+    }
+
+    EXPECT_FALSE(fq());
+}
+
+TEST_P(FastqReaderFileTest, StressTestNoNames) {
+    std::string path = "TEST_reader.fastq";
+    {
+        std::ofstream out(path);
+        for (size_t i = 0; i < 1000; ++i) {
+            out << "@" << "READ_" << i << " extra\n";
+            out << "ACGTACGTACGTACGTACGTacgtacgtacg\n";
+            out << "+" << "\n";
+            out << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+        }
+    }
+    byteme::RawFileReader reader(path, GetParam());
+    kaori::FastqReader<false> fq(&reader, true);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(fq());
+        auto name = fq.get_name_view();
+        EXPECT_EQ(name.first, name.second);
+        auto seq = fq.get_sequence_view();
+        EXPECT_EQ(std::string(seq.first, seq.second), "ACGTACGTACGTACGTACGTacgtacgtacg");
+    }
+
+    EXPECT_FALSE(fq());
+}
+
 INSTANTIATE_TEST_SUITE_P(
     FastqReader,
     FastqReaderFileTest, 
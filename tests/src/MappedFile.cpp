@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "kaori/MappedFile.hpp"
+#include <fstream>
+#include <string>
+
+TEST(MappedFile, Basic) {
+    std::string path = "TEST_mapped.txt";
+    std::string contents;
+    for (size_t i = 0; i < 1000; ++i) {
+        contents += "@READ" + std::to_string(i) + "\nACGT\n+\n!!!!\n";
+    }
+    {
+        std::ofstream out(path);
+        out << contents;
+    }
+
+    kaori::MappedFile mapped(path);
+    ASSERT_EQ(mapped.size(), contents.size());
+    EXPECT_EQ(std::string(mapped.data(), mapped.data() + mapped.size()), contents);
+}
+
+TEST(MappedFile, Empty) {
+    std::string path = "TEST_mapped.txt";
+    {
+        std::ofstream out(path);
+    }
+
+    kaori::MappedFile mapped(path);
+    EXPECT_EQ(mapped.size(), 0);
+}
+
+TEST(MappedFile, Errors) {
+    EXPECT_ANY_THROW({
+        try {
+            kaori::MappedFile mapped("TEST_missing.txt");
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("failed to open") != std::string::npos);
+            throw e;
+        }
+    });
+}
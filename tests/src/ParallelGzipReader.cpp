@@ -0,0 +1,290 @@
+#include <gtest/gtest.h>
+#include "kaori/ParallelGzipReader.hpp"
+#include "kaori/process_data.hpp"
+#include "byteme/RawBufferReader.hpp"
+#include "byteme/RawFileReader.hpp"
+#include "zlib.h"
+#include <fstream>
+#include <random>
+#include "utils.h"
+
+static std::string deflate_member(const std::string& contents, int window_bits) {
+    z_stream strm;
+    std::memset(&strm, 0, sizeof(z_stream));
+    deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+
+    std::string output(deflateBound(&strm, contents.size()), '\0');
+    strm.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(contents.data()));
+    strm.avail_in = contents.size();
+    strm.next_out = reinterpret_cast<unsigned char*>(&output[0]);
+    strm.avail_out = output.size();
+    deflate(&strm, Z_FINISH);
+    output.resize(output.size() - strm.avail_out);
+    deflateEnd(&strm);
+    return output;
+}
+
+static void add_little_endian(std::string& output, uint32_t value, int nbytes) {
+    for (int i = 0; i < nbytes; ++i) {
+        output += static_cast<char>((value >> (8 * i)) & 255);
+    }
+}
+
+static std::string to_bgzf(const std::string& contents, size_t block_size) {
+    std::string output;
+
+    auto add_block = [&](const std::string& chunk) -> void {
+        auto raw = deflate_member(chunk, -15);
+        output += std::string("\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00", 16);
+        add_little_endian(output, raw.size() + 25, 2); // header (18) + trailer (8) - 1.
+        output += raw;
+        add_little_endian(output, crc32(0, reinterpret_cast<const unsigned char*>(chunk.data()), chunk.size()), 4);
+        add_little_endian(output, chunk.size(), 4);
+    };
+
+    for (size_t i = 0; i < contents.size(); i += block_size) {
+        add_block(contents.substr(i, block_size));
+    }
+    add_block(""); // EOF marker.
+    return output;
+}
+
+static std::string to_gzip(const std::string& contents, size_t member_size) {
+    std::string output;
+    for (size_t i = 0; i < contents.size(); i += member_size) {
+        output += deflate_member(contents.substr(i, member_size), 31);
+    }
+    return output;
+}
+
+static std::string decompress_all(byteme::Reader& reader) {
+    std::string output;
+    bool remaining = true;
+    while (remaining) {
+        remaining = reader();
+        auto ptr = reinterpret_cast<const char*>(reader.buffer());
+        output.insert(output.end(), ptr, ptr + reader.available());
+    }
+    return output;
+}
+
+class ParallelGzipReaderTest : public testing::TestWithParam<std::tuple<int, int> > {
+protected:
+    static std::string simulate_contents() {
+        std::mt19937_64 rng(1234);
+        std::string output;
+        for (size_t i = 0; i < 50000; ++i) {
+            output += "ACGT"[rng() % 4];
+            if (i % 73 == 0) {
+                output += '\n';
+            }
+        }
+        return output;
+    }
+};
+
+TEST_P(ParallelGzipReaderTest, Bgzf) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto batch = std::get<1>(param);
+
+    auto contents = simulate_contents();
+    auto compressed = to_bgzf(contents, 1000);
+
+    {
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_EQ(decompress_all(reader), contents);
+    }
+
+    // Works with a source that provides small chunks.
+    std::string path = "TEST_bgzf.gz";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << compressed;
+    }
+    {
+        byteme::RawFileReader src(path, 77);
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_EQ(decompress_all(reader), contents);
+    }
+}
+
+TEST_P(ParallelGzipReaderTest, Gzip) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto batch = std::get<1>(param);
+
+    auto contents = simulate_contents();
+
+    // Single member.
+    {
+        auto compressed = to_gzip(contents, contents.size());
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_EQ(decompress_all(reader), contents);
+    }
+
+    // Multiple concatenated members.
+    {
+        auto compressed = to_gzip(contents, 7777);
+        std::string path = "TEST_gzip.gz";
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << compressed;
+        }
+        byteme::RawFileReader src(path, 101);
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_EQ(decompress_all(reader), contents);
+    }
+
+    // Switching from BGZF to Gzip.
+    {
+        auto half = contents.size() / 2;
+        auto compressed = to_bgzf(contents.substr(0, half), 1000) + to_gzip(contents.substr(half), 5000);
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_EQ(decompress_all(reader), contents);
+    }
+}
+
+TEST_P(ParallelGzipReaderTest, ProcessData) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto batch = std::get<1>(param);
+
+    std::vector<std::string> reads;
+    for (size_t i = 0; i < 1000; ++i) {
+        reads.push_back(std::string(i % 50 + 10, "ACGT"[i % 4]));
+    }
+    auto fastq = convert_to_fastq(reads);
+    auto compressed = to_bgzf(fastq, 500);
+
+    byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+    kaori::ParallelGzipReader reader(&src, nthreads, batch);
+    kaori::FastqReader fq(&reader);
+
+    for (size_t i = 0; i < reads.size(); ++i) {
+        ASSERT_TRUE(fq());
+        const auto& seq = fq.get_sequence();
+        EXPECT_EQ(std::string(seq.begin(), seq.end()), reads[i]);
+    }
+    EXPECT_FALSE(fq());
+}
+
+TEST_P(ParallelGzipReaderTest, EmptyBlocks) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto batch = std::get<1>(param);
+
+    std::vector<std::string> reads;
+    for (size_t i = 0; i < 500; ++i) {
+        reads.push_back(std::string(i % 50 + 10, "ACGT"[i % 4]));
+    }
+    auto fastq = convert_to_fastq(reads);
+
+    // Leading and interleaved empty blocks, each of which is identical to the EOF marker.
+    auto empty = to_bgzf("", 1000);
+    auto half = fastq.size() / 2;
+    auto compressed = empty + empty + to_bgzf(fastq.substr(0, half), 500) + empty + empty + to_bgzf(fastq.substr(half), 500) + empty;
+
+    {
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        std::string output;
+        while (reader()) {
+            EXPECT_GT(reader.available(), 0);
+            auto ptr = reinterpret_cast<const char*>(reader.buffer());
+            output.insert(output.end(), ptr, ptr + reader.available());
+        }
+        auto ptr = reinterpret_cast<const char*>(reader.buffer());
+        output.insert(output.end(), ptr, ptr + reader.available());
+        EXPECT_EQ(output, fastq);
+    }
+
+    {
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(compressed.data()), compressed.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        kaori::FastqReader fq(&reader);
+        for (size_t i = 0; i < reads.size(); ++i) {
+            ASSERT_TRUE(fq());
+            const auto& seq = fq.get_sequence();
+            EXPECT_EQ(std::string(seq.begin(), seq.end()), reads[i]);
+        }
+        EXPECT_FALSE(fq());
+    }
+
+    // Nothing but empty blocks.
+    {
+        auto only_empty = empty + empty + empty;
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(only_empty.data()), only_empty.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_FALSE(reader());
+        EXPECT_EQ(reader.available(), 0);
+    }
+}
+
+TEST_P(ParallelGzipReaderTest, Errors) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto batch = std::get<1>(param);
+
+    auto contents = simulate_contents();
+    auto compressed = to_bgzf(contents, 1000);
+
+    // Corrupting the CRC of one of the blocks.
+    {
+        auto copy = compressed;
+        auto bsize = (static_cast<unsigned char>(copy[16]) | (static_cast<unsigned char>(copy[17]) << 8)) + 1;
+        copy[bsize - 8] ^= 1;
+
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(copy.data()), copy.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_ANY_THROW({
+            try {
+                decompress_all(reader);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("CRC mismatch") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    // Truncating the stream.
+    {
+        auto copy = compressed.substr(0, compressed.size() / 2);
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(copy.data()), copy.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_ANY_THROW({
+            try {
+                decompress_all(reader);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("incomplete") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    // Not a Gzip file at all.
+    {
+        byteme::RawBufferReader src(reinterpret_cast<const unsigned char*>(contents.data()), contents.size());
+        kaori::ParallelGzipReader reader(&src, nthreads, batch);
+        EXPECT_ANY_THROW({
+            try {
+                decompress_all(reader);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("invalid Gzip header") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParallelGzipReader,
+    ParallelGzipReaderTest, 
+    ::testing::Combine(
+        ::testing::Values(1, 2, 4), // number of threads
+        ::testing::Values(1, 5000, 1000000) // batch size
+    )
+);
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "kaori/PrefetchReader.hpp"
+#include "kaori/process_data.hpp"
+#include "byteme/RawBufferReader.hpp"
+#include "byteme/RawFileReader.hpp"
+#include <fstream>
+#include "utils.h"
+
+class PrefetchReaderTest : public testing::TestWithParam<std::tuple<int, int, int> > {
+protected:
+    static std::string read_all(byteme::Reader& reader) {
+        std::string output;
+        bool remaining = true;
+        while (remaining) {
+            remaining = reader();
+            auto ptr = reinterpret_cast<const char*>(reader.buffer());
+            output.insert(output.end(), ptr, ptr + reader.available());
+        }
+        return output;
+    }
+};
+
+TEST_P(PrefetchReaderTest, Basic) {
+    auto param = GetParam();
+    auto nbuffers = std::get<0>(param);
+    auto bufsize = std::get<1>(param);
+    auto chunksize = std::get<2>(param);
+
+    std::vector<std::string> reads;
+    for (size_t i = 0; i < 1000; ++i) {
+        reads.push_back(std::string(i % 50 + 10, "ACGT"[i % 4]));
+    }
+    auto contents = convert_to_fastq(reads);
+
+    std::string path = "TEST_prefetch.fastq";
+    {
+        std::ofstream out(path);
+        out << contents;
+    }
+
+    {
+        byteme::RawFileReader src(path, chunksize);
+        kaori::PrefetchReader reader(&src, nbuffers, bufsize);
+        EXPECT_EQ(read_all(reader), contents);
+        EXPECT_FALSE(reader()); // further calls are harmless.
+        EXPECT_EQ(reader.available(), 0);
+    }
+
+    {
+        byteme::RawFileReader src(path, chunksize);
+        kaori::PrefetchReader reader(&src, nbuffers, bufsize);
+        kaori::FastqReader fq(&reader);
+        for (size_t i = 0; i < reads.size(); ++i) {
+            ASSERT_TRUE(fq());
+            const auto& seq = fq.get_sequence();
+            EXPECT_EQ(std::string(seq.begin(), seq.end()), reads[i]);
+        }
+        EXPECT_FALSE(fq());
+    }
+
+    // Destruction works without reading everything.
+    {
+        byteme::RawFileReader src(path, chunksize);
+        kaori::PrefetchReader reader(&src, nbuffers, bufsize);
+        reader();
+    }
+}
+
+class FailingReader : public byteme::Reader {
+public:
+    bool operator()() {
+        ++counter;
+        if (counter > 3) {
+            throw std::runtime_error("I want a hot dog");
+        }
+        return true;
+    }
+    const unsigned char* buffer() const {
+        return reinterpret_cast<const unsigned char*>(contents.c_str());
+    }
+    size_t available() const {
+        return contents.size();
+    }
+private:
+    int counter = 0;
+    std::string contents = "ACGT";
+};
+
+TEST_P(PrefetchReaderTest, Errors) {
+    auto param = GetParam();
+    auto nbuffers = std::get<0>(param);
+    auto bufsize = std::get<1>(param);
+
+    FailingReader src;
+    kaori::PrefetchReader reader(&src, nbuffers, bufsize);
+    EXPECT_ANY_THROW({
+        try {
+            read_all(reader);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("hot dog") != std::string::npos);
+            throw e;
+        }
+    });
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PrefetchReader,
+    PrefetchReaderTest, 
+    ::testing::Combine(
+        ::testing::Values(2, 3, 5), // number of buffers
+        ::testing::Values(1, 100, 100000), // buffer size
+        ::testing::Values(10, 1000) // chunk size of the source
+    )
+);
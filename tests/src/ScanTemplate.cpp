@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "kaori/ScanTemplate.hpp"
 #include <string>
+#include <random>
+#include <bitset>
 
 TEST(ScanTemplate, Basic) {
     std::string thing = "ACGT----TTTT"; 
@@ -205,8 +207,13 @@ TEST(ScanTemplate, BadBases) {
         stuff.next(out);
         EXPECT_EQ(out.forward_mismatches, 1);
         EXPECT_FALSE(out.finished);
-        EXPECT_EQ(out.ambiguous.count(), 4);
-        EXPECT_EQ(out.bad.size(), 1);
+        size_t nambiguous = 0;
+        for (auto w : out.ambiguous) {
+            nambiguous += std::bitset<64>(w).count();
+        }
+        EXPECT_EQ(nambiguous, 1); // one flag per ambiguous base.
+        EXPECT_TRUE(out.any_ambiguous);
+        EXPECT_EQ(out.last_ambiguous, 13);
     }
 
     // Clears existing Ns.
@@ -223,6 +230,158 @@ TEST(ScanTemplate, BadBases) {
         stuff.next(out);
         EXPECT_EQ(out.forward_mismatches, 0);
         EXPECT_FALSE(out.finished);
-        EXPECT_TRUE(out.bad.empty());
+        EXPECT_FALSE(out.any_ambiguous);
+    }
+}
+
+template<size_t max_size>
+void compare_to_reference(size_t template_length, int seed) {
+    std::mt19937_64 rng(seed);
+    const char* bases = "ACGTacgtN";
+
+    std::string thing;
+    for (size_t i = 0; i < template_length; ++i) {
+        thing += (rng() % 4 == 0 ? '-' : "ACGT"[rng() % 4]);
+    }
+
+    // Naive per-position counting of mismatches in the constant regions,
+    // where ambiguous read bases are always considered to be mismatches.
+    auto reference = [&](const std::string& seq, size_t pos, bool reverse) -> int {
+        int mm = 0;
+        for (size_t i = 0; i < template_length; ++i) {
+            char t = (reverse ? thing[template_length - i - 1] : thing[i]);
+            if (t == '-') {
+                continue;
+            }
+            if (reverse) {
+                t = (t == 'A' ? 'T' : t == 'C' ? 'G' : t == 'G' ? 'C' : 'A');
+            }
+            char r = std::toupper(seq[pos + i]);
+            mm += (r != t);
+        }
+        return mm;
+    };
+
+    kaori::ScanTemplate<max_size> stuff(thing.c_str(), thing.size(), true, true);
+    typename kaori::ScanTemplate<max_size>::State out; // re-used across reads.
+    for (int it = 0; it < 20; ++it) {
+        std::string seq;
+        size_t len = template_length + rng() % 50;
+        for (size_t i = 0; i < len; ++i) {
+            // Mostly matching the template so that we get some low mismatch counts.
+            char t = thing[i % template_length];
+            if (t != '-' && rng() % 4 != 0) {
+                seq += t;
+            } else {
+                seq += bases[rng() % 9];
+            }
+        }
+
+        stuff.initialize(seq.c_str(), seq.size(), out);
+        bool okay = true;
+        size_t pos = 0;
+        while (!out.finished) {
+            stuff.next(out);
+            if (out.position != pos || out.forward_mismatches != reference(seq, pos, false) || out.reverse_mismatches != reference(seq, pos, true)) {
+                okay = false;
+            }
+            ++pos;
+        }
+        EXPECT_TRUE(okay);
+        EXPECT_EQ(pos, len - template_length + 1);
     }
 }
+
+TEST(ScanTemplate, Reference) {
+    compare_to_reference<16>(12, 1);
+    compare_to_reference<16>(16, 2);
+    compare_to_reference<32>(32, 3);
+    compare_to_reference<64>(33, 4); // crosses a word boundary.
+    compare_to_reference<64>(64, 5);
+    compare_to_reference<256>(100, 6);
+    compare_to_reference<256>(256, 7);
+
+    // Sized at run time.
+    compare_to_reference<0>(12, 8);
+    compare_to_reference<0>(32, 9);
+    compare_to_reference<0>(33, 10);
+    compare_to_reference<0>(100, 11);
+    compare_to_reference<0>(300, 12); // no upper limit.
+}
+
+template<size_t max_size>
+void compare_batch(size_t template_length, int seed, bool forward, bool reverse) {
+    std::mt19937_64 rng(seed);
+    const char* bases = "ACGTacgtN";
+
+    std::string thing;
+    for (size_t i = 0; i < template_length; ++i) {
+        thing += (rng() % 4 == 0 ? '-' : "ACGT"[rng() % 4]);
+    }
+    kaori::ScanTemplate<max_size> stuff(thing.c_str(), thing.size(), forward, reverse);
+
+    // Including reads that are shorter than the template, and a number of
+    // reads that isn't a multiple of the vector width.
+    std::vector<std::string> seqs;
+    for (int it = 0; it < 23; ++it) {
+        std::string seq;
+        size_t len = template_length + rng() % 50;
+        len = (len >= 5 ? len - 5 : 0);
+        for (size_t i = 0; i < len; ++i) {
+            char t = thing[i % template_length];
+            if (t != '-' && rng() % 4 != 0) {
+                seq += t;
+            } else {
+                seq += bases[rng() % 9];
+            }
+        }
+        seqs.push_back(std::move(seq));
+    }
+
+    std::vector<std::pair<const char*, const char*> > reads;
+    for (const auto& s : seqs) {
+        reads.emplace_back(s.c_str(), s.c_str() + s.size());
+    }
+
+    for (int threshold : { 0, 2, 5 }) {
+        std::vector<typename kaori::ScanTemplate<max_size>::Candidate> expected;
+        typename kaori::ScanTemplate<max_size>::State out;
+        for (size_t r = 0; r < reads.size(); ++r) {
+            stuff.initialize(seqs[r].c_str(), seqs[r].size(), out);
+            while (!out.finished) {
+                stuff.next(out);
+                if ((forward && out.forward_mismatches <= threshold) || (reverse && out.reverse_mismatches <= threshold)) {
+                    expected.push_back({ r, out.position, out.forward_mismatches, out.reverse_mismatches });
+                }
+            }
+        }
+
+        std::vector<typename kaori::ScanTemplate<max_size>::Candidate> observed;
+        stuff.scan_batch(reads.data(), reads.size(), threshold, observed);
+        ASSERT_EQ(expected.size(), observed.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            EXPECT_EQ(expected[i].read, observed[i].read);
+            EXPECT_EQ(expected[i].position, observed[i].position);
+            EXPECT_EQ(expected[i].forward_mismatches, observed[i].forward_mismatches);
+            EXPECT_EQ(expected[i].reverse_mismatches, observed[i].reverse_mismatches);
+        }
+    }
+}
+
+TEST(ScanTemplate, Batch) {
+    compare_batch<16>(12, 1, true, false);
+    compare_batch<16>(16, 2, false, true);
+    compare_batch<32>(32, 3, true, true);
+    compare_batch<64>(33, 4, true, true); // more than one word, so no vectorization.
+    compare_batch<64>(20, 7, true, true); // short templates are still vectorized with a larger max_size.
+    compare_batch<256>(32, 8, true, false);
+    compare_batch<0>(20, 5, true, true);
+    compare_batch<0>(100, 6, true, false);
+
+    // Empty batches are a no-op.
+    std::string thing = "ACGT----TTTT"; 
+    kaori::ScanTemplate<16> stuff(thing.c_str(), thing.size(), true, false);
+    std::vector<kaori::ScanTemplate<16>::Candidate> observed;
+    stuff.scan_batch(NULL, 0, 1, observed);
+    EXPECT_TRUE(observed.empty());
+}
@@ -2,6 +2,8 @@
 #include "kaori/SimpleSingleMatch.hpp"
 #include <string>
 #include <vector>
+#include <random>
+#include <algorithm>
 #include "utils.h"
 
 TEST(SimpleSingleMatch, BasicFirst) {
@@ -290,6 +292,83 @@ TEST(SimpleSingleMatch, ReverseComplementBest) {
     }
 }
 
+template<size_t max_size>
+void compare_batch(const std::string& constant, bool forward, bool reverse, int max_mm, int seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT", "ACGT", "TGCA" };
+    kaori::BarcodePool ptrs(variables);
+    kaori::SimpleSingleMatch<max_size> stuff(constant.c_str(), constant.size(), forward, reverse, ptrs, max_mm);
+
+    // Mutating a mix of forward and reverse-complemented targets in random flanks,
+    // including multiple targets per read and reads shorter than the template.
+    const char* bases = "ACGTN";
+    std::vector<std::string> seqs;
+    for (int r = 0; r < 50; ++r) {
+        std::string seq;
+        for (int t = 0, ntargets = rng() % 3; t < ntargets; ++t) {
+            for (int i = 0, nflank = rng() % 10; i < nflank; ++i) {
+                seq += bases[rng() % 5];
+            }
+            std::string target = constant;
+            auto v = variables[rng() % variables.size()];
+            std::copy(v.begin(), v.end(), target.begin() + target.find('-'));
+            if (rng() % 2) {
+                std::string rc(target.rbegin(), target.rend());
+                for (auto& x : rc) {
+                    x = reverse_complement(x);
+                }
+                target.swap(rc);
+            }
+            for (int m = 0, nmm = rng() % 3; m < nmm; ++m) {
+                target[rng() % target.size()] = bases[rng() % 5];
+            }
+            seq += target;
+        }
+        for (int i = 0, nflank = rng() % 10; i < nflank; ++i) {
+            seq += bases[rng() % 5];
+        }
+        seqs.push_back(std::move(seq));
+    }
+
+    std::vector<std::pair<const char*, const char*> > reads;
+    for (const auto& s : seqs) {
+        reads.emplace_back(s.c_str(), s.c_str() + s.size());
+    }
+
+    for (bool use_first : { true, false }) {
+        auto ref_state = stuff.initialize();
+        auto batch_state = stuff.initialize();
+        size_t counter = 0;
+
+        stuff.search_batch(reads.data(), reads.size(), use_first, batch_state, [&](size_t r, bool found) -> void {
+            EXPECT_EQ(r, counter);
+            ++counter;
+
+            const auto& seq = seqs[r];
+            bool expected = (use_first ? stuff.search_first(seq.c_str(), seq.size(), ref_state) : stuff.search_best(seq.c_str(), seq.size(), ref_state));
+            EXPECT_EQ(found, expected);
+            EXPECT_EQ(batch_state.index, ref_state.index);
+            if (found) {
+                EXPECT_EQ(batch_state.position, ref_state.position);
+                EXPECT_EQ(batch_state.mismatches, ref_state.mismatches);
+                EXPECT_EQ(batch_state.variable_mismatches, ref_state.variable_mismatches);
+                EXPECT_EQ(batch_state.reverse, ref_state.reverse);
+            }
+        });
+
+        EXPECT_EQ(counter, reads.size());
+    }
+}
+
+TEST(SimpleSingleMatch, Batch) {
+    compare_batch<16>("ACGT----TGCA", true, false, 1, 1);
+    compare_batch<16>("ACGT----TGCA", false, true, 2, 2);
+    compare_batch<32>("ACGTAC----TGCAGT", true, true, 2, 3);
+    compare_batch<64>("ACGTAC----TGCAGT", true, true, 1, 4); // vectorized despite the larger max_size.
+    compare_batch<64>("ACGTACGTACGTACGTAC----TGCATGCATGCATGCA", true, true, 2, 5); // not vectorized.
+    compare_batch<0>("ACGT----TGCA", true, true, 1, 6);
+}
+
 TEST(SimpleSingleMatch, Caching) {
     std::string constant = "ACGT----TGCA";
     std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
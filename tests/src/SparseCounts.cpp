@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "kaori/SparseCounts.hpp"
+#include <vector>
+#include <cstdint>
+
+TEST(SparseCounts, Basic) {
+    kaori::SparseCounts<uint64_t> sparse;
+    EXPECT_TRUE(sparse.empty());
+    EXPECT_EQ(sparse.count(3), 0);
+
+    sparse.add(3);
+    sparse.add(1);
+    sparse.add(3);
+    EXPECT_FALSE(sparse.empty());
+    EXPECT_EQ(sparse.size(), 2);
+    EXPECT_EQ(sparse.count(3), 2);
+    EXPECT_EQ(sparse.count(1), 1);
+    EXPECT_EQ(sparse.count(0), 0);
+    EXPECT_EQ(sparse.count(10), 0);
+
+    std::vector<uint64_t> dense(5, 1);
+    sparse.transfer(dense);
+    EXPECT_EQ(dense, std::vector<uint64_t>({ 1, 2, 1, 3, 1 }));
+    EXPECT_TRUE(sparse.empty());
+    EXPECT_EQ(sparse.count(3), 0);
+
+    // Re-using the object after the transfer.
+    sparse.add(4);
+    sparse.add(3);
+    EXPECT_EQ(sparse.size(), 2);
+    sparse.transfer(dense);
+    EXPECT_EQ(dense, std::vector<uint64_t>({ 1, 2, 1, 4, 2 }));
+}
+
+TEST(SparseCounts, Growth) {
+    // Large and scattered indices, forcing the lookup table to grow several times.
+    kaori::SparseCounts<uint64_t> sparse;
+    std::vector<int> indices;
+    for (int i = 0; i < 1000; ++i) {
+        indices.push_back(i * 1009 + 7);
+    }
+
+    for (int rep = 0; rep < 3; ++rep) {
+        for (size_t i = 0; i < indices.size(); i += rep + 1) {
+            sparse.add(indices[i]);
+        }
+    }
+
+    EXPECT_EQ(sparse.size(), indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        uint64_t expected = 1 + (i % 2 == 0) + (i % 3 == 0);
+        EXPECT_EQ(sparse.count(indices[i]), expected);
+        EXPECT_EQ(sparse.count(indices[i] + 1), 0);
+    }
+
+    std::vector<uint64_t> dense(indices.back() + 1);
+    sparse.transfer(dense);
+    EXPECT_TRUE(sparse.empty());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        EXPECT_EQ(dense[indices[i]], 1 + (i % 2 == 0) + (i % 3 == 0));
+        EXPECT_EQ(sparse.count(indices[i]), 0);
+    }
+
+    // Indices near the top of the range don't need a lookup of that size.
+    sparse.add(2000000000);
+    sparse.add(2000000000);
+    sparse.add(indices.back());
+    EXPECT_EQ(sparse.count(2000000000), 2);
+    EXPECT_EQ(sparse.count(indices.back()), 1);
+    EXPECT_EQ(sparse.size(), 2);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "kaori/ThreadPool.hpp"
+#include <vector>
+#include <future>
+#include <atomic>
+
+TEST(ThreadPool, Basic) {
+    for (int nthreads = 1; nthreads <= 4; ++nthreads) {
+        kaori::ThreadPool pool(nthreads);
+        EXPECT_EQ(pool.size(), nthreads);
+
+        std::vector<int> results(100);
+        std::vector<std::future<void> > jobs;
+        for (int i = 0; i < 100; ++i) {
+            jobs.push_back(pool.submit([&, i]() -> void { results[i] = i * 2; }));
+        }
+        for (auto& j : jobs) {
+            j.get();
+        }
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(results[i], i * 2);
+        }
+    }
+}
+
+TEST(ThreadPool, Destruction) {
+    // All submitted tasks are run before the pool is destroyed.
+    std::atomic<int> counter(0);
+    {
+        kaori::ThreadPool pool(2);
+        for (int i = 0; i < 100; ++i) {
+            pool.submit([&]() -> void { ++counter; });
+        }
+    }
+    EXPECT_EQ(counter.load(), 100);
+}
+
+TEST(ThreadPool, Errors) {
+    kaori::ThreadPool pool(2);
+    auto fut = pool.submit([]() -> void { throw std::runtime_error("I want a pizza"); });
+    EXPECT_ANY_THROW({
+        try {
+            fut.get();
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("pizza") != std::string::npos);
+            throw e;
+        }
+    });
+
+    // Pool is still usable afterwards.
+    int val = 0;
+    pool.submit([&]() -> void { val = 1; }).get();
+    EXPECT_EQ(val, 1);
+
+    EXPECT_ANY_THROW({
+        try {
+            kaori::ThreadPool pool(0);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("positive") != std::string::npos);
+            throw e;
+        }
+    });
+}
+
+TEST(ThreadPool, WorkerIndex) {
+    kaori::ThreadPool pool(3), other(2);
+    EXPECT_EQ(pool.worker_index(), -1);
+
+    std::vector<int> indices(100), foreign(100);
+    std::vector<std::future<void> > jobs;
+    for (int i = 0; i < 100; ++i) {
+        jobs.push_back(pool.submit([&, i]() -> void { 
+            indices[i] = pool.worker_index(); 
+            foreign[i] = other.worker_index();
+        }));
+    }
+    for (auto& j : jobs) {
+        j.get();
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(indices[i] >= 0 && indices[i] < 3);
+        EXPECT_EQ(foreign[i], -1);
+    }
+}
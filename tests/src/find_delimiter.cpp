@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "kaori/find_delimiter.hpp"
+#include <random>
+#include <string>
+#include <cctype>
+
+TEST(FindDelimiter, Basic) {
+    std::string x = "ACGT\nTGCA";
+    EXPECT_EQ(kaori::find_newline(x.c_str(), x.c_str() + x.size()), x.c_str() + 4);
+    EXPECT_EQ(kaori::find_whitespace(x.c_str(), x.c_str() + x.size()), x.c_str() + 4);
+
+    std::string y = "FOO\tBAR";
+    EXPECT_EQ(kaori::find_newline(y.c_str(), y.c_str() + y.size()), y.c_str() + y.size());
+    EXPECT_EQ(kaori::find_whitespace(y.c_str(), y.c_str() + y.size()), y.c_str() + 3);
+
+    std::string z = "";
+    EXPECT_EQ(kaori::find_newline(z.c_str(), z.c_str()), z.c_str());
+    EXPECT_EQ(kaori::find_whitespace(z.c_str(), z.c_str()), z.c_str());
+}
+
+TEST(FindDelimiter, AllCharacters) {
+    // Checking every possible character against std::isspace, in every
+    // position of a block to exercise both the vectorized and scalar code.
+    for (int c = 0; c < 256; ++c) {
+        char current = static_cast<char>(c);
+        bool expected_ws = std::isspace(static_cast<unsigned char>(c));
+        bool expected_nl = (current == '\n');
+
+        for (size_t len : { 5, 16, 33, 70 }) {
+            for (size_t pos = 0; pos < len; ++pos) {
+                std::string x(len, 'A');
+                x[pos] = current;
+                auto start = x.c_str(), end = start + x.size();
+                EXPECT_EQ(kaori::find_whitespace(start, end), start + (expected_ws ? pos : len));
+                EXPECT_EQ(kaori::find_newline(start, end), start + (expected_nl ? pos : len));
+            }
+        }
+    }
+}
+
+TEST(FindDelimiter, Random) {
+    std::mt19937_64 rng(42);
+    const std::string choices = "ACGTN!#@+ \t\r\n";
+
+    for (size_t it = 0; it < 500; ++it) {
+        std::string x;
+        size_t len = rng() % 200;
+        for (size_t i = 0; i < len; ++i) {
+            x += choices[rng() % choices.size()];
+        }
+
+        auto start = x.c_str(), end = start + x.size();
+        for (size_t offset = 0; offset < std::min(x.size(), static_cast<size_t>(40)); ++offset) {
+            EXPECT_EQ(kaori::find_newline(start + offset, end), kaori::find_newline_scalar(start + offset, end));
+            EXPECT_EQ(kaori::find_whitespace(start + offset, end), kaori::find_whitespace_scalar(start + offset, end));
+        }
+    }
+}
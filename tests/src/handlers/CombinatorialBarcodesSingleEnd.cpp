@@ -4,6 +4,8 @@
 #include "byteme/RawBufferReader.hpp"
 #include "../utils.h"
 #include <string>
+#include <sstream>
+#include <algorithm>
 
 class CombinatorialBarcodesSingleEndTest : public testing::Test {
 protected:
@@ -355,3 +357,61 @@ TEST_F(CombinatorialBarcodesSingleEndTest, Error) {
         }
     });
 }
+
+TEST_F(CombinatorialBarcodesSingleEndTest, MergeResults) {
+    std::vector<std::string> seq;
+    for (int i = 0; i < 100; ++i) {
+        seq.push_back("cagAAAA" + variables1[(i * 7) % 5 % 4] + "CGGC" + variables2[(i * 3) % 7 % 4] + "TTTTacac");
+    }
+    std::string fq = convert_to_fastq(seq);
+
+    typedef kaori::CombinatorialBarcodesSingleEnd<128, 2> Thing;
+    Thing ref(constant.c_str(), constant.size(), 0, make_pointers());
+    kaori::process_single_end_buffer(fq.c_str(), fq.size(), ref);
+    ref.sort();
+
+    // Processing each shard separately, as if they were on different machines.
+    size_t nshards = 3;
+    std::vector<std::string> serialized;
+    for (size_t s = 0; s < nshards; ++s) {
+        auto range = kaori::find_fastq_shard(fq.c_str(), fq.size(), s, nshards);
+        Thing handler(constant.c_str(), constant.size(), 0, make_pointers());
+        kaori::process_single_end_buffer(fq.c_str() + range.first, range.second - range.first, handler);
+        EXPECT_LT(handler.get_total(), ref.get_total());
+
+        std::ostringstream out;
+        handler.write_results(out);
+        serialized.push_back(out.str());
+    }
+
+    Thing merged(constant.c_str(), constant.size(), 0, make_pointers());
+    for (const auto& x : serialized) {
+        std::istringstream in(x);
+        merged.merge_results(in);
+    }
+    merged.sort();
+    EXPECT_EQ(merged.get_combinations(), ref.get_combinations());
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+
+    // Errors for incompatible results.
+    {
+        std::istringstream in("kaori::CombinatorialBarcodesPairedEnd 1\n");
+        EXPECT_ANY_THROW({
+            try {
+                merged.merge_results(in);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("compatible") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    {
+        std::istringstream in(serialized.front().substr(0, serialized.front().size() / 2));
+        EXPECT_ANY_THROW(merged.merge_results(in));
+    }
+
+    // Failed merges should not modify the handler.
+    EXPECT_EQ(merged.get_combinations(), ref.get_combinations());
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+}
@@ -4,6 +4,7 @@
 #include "byteme/RawBufferReader.hpp"
 #include "../utils.h"
 #include <string>
+#include <sstream>
 
 class DualBarcodesWithDiagnosticsTest : public testing::Test {
 protected:
@@ -63,6 +64,127 @@ TEST_F(DualBarcodesWithDiagnosticsTest, BasicFirst) {
     EXPECT_EQ(stuff.get_barcode2_only(), 1);
 }
 
+TEST_F(DualBarcodesWithDiagnosticsTest, RuntimeSize) {
+    std::vector<std::string> seq1{ 
+        "cagcatcgatcgtgaAAAACCCCCGGCacggaggaga",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "acacacacacac"
+    };
+    std::string fq1 = convert_to_fastq(seq1);
+
+    std::vector<std::string> seq2{ 
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT", 
+        "AGCTAGAGAGTTTTaaaaccccggg",
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT",
+        "acacacacacaca",
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT"
+    };
+    std::string fq2 = convert_to_fastq(seq2);
+
+    byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fq1.c_str()), fq1.size());
+    byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fq2.c_str()), fq2.size());
+
+    kaori::DualBarcodesWithDiagnostics<0> stuff(
+        constant1.c_str(), constant1.size(), false, kaori::BarcodePool(variables1), 0,
+        constant2.c_str(), constant2.size(), false, kaori::BarcodePool(variables2), 0
+    );
+    kaori::process_paired_end_data(&reader1, &reader2, stuff);
+
+    // Same results as in BasicFirst.
+    EXPECT_EQ(stuff.get_total(), 5);
+    EXPECT_EQ(stuff.get_counts(), std::vector<uint64_t>({ 0, 1, 1, 0 }));
+
+    stuff.sort();
+    const auto& combos = stuff.get_combinations();
+    ASSERT_EQ(combos.size(), 1);
+    EXPECT_EQ(combos.front()[0], 2);
+    EXPECT_EQ(combos.front()[1], 1);
+
+    EXPECT_EQ(stuff.get_barcode1_only(), 1);
+    EXPECT_EQ(stuff.get_barcode2_only(), 1);
+}
+
+TEST_F(DualBarcodesWithDiagnosticsTest, MergeResults) {
+    std::vector<std::string> seq1{ 
+        "cagcatcgatcgtgaAAAACCCCCGGCacggaggaga",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "AAAAGGGGCGGCaaaaccccggg",
+        "acacacacacac"
+    };
+
+    std::vector<std::string> seq2{ 
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT", 
+        "AGCTAGAGAGTTTTaaaaccccggg",
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT",
+        "acacacacacaca",
+        "cagcatcgatcgtgaAGCTTGTGTGTTTT"
+    };
+
+    auto create = [&]() -> kaori::DualBarcodesWithDiagnostics<32> {
+        return kaori::DualBarcodesWithDiagnostics<32>(
+            constant1.c_str(), constant1.size(), false, kaori::BarcodePool(variables1), 0,
+            constant2.c_str(), constant2.size(), false, kaori::BarcodePool(variables2), 0
+        );
+    };
+
+    auto run = [&](kaori::DualBarcodesWithDiagnostics<32>& handler, size_t start, size_t end) -> void {
+        std::string fq1 = convert_to_fastq(std::vector<std::string>(seq1.begin() + start, seq1.begin() + end));
+        std::string fq2 = convert_to_fastq(std::vector<std::string>(seq2.begin() + start, seq2.begin() + end));
+        byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fq1.c_str()), fq1.size());
+        byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fq2.c_str()), fq2.size());
+        kaori::process_paired_end_data(&reader1, &reader2, handler);
+    };
+
+    auto ref = create();
+    run(ref, 0, seq1.size());
+    ref.sort();
+
+    std::stringstream buffer;
+    {
+        auto first = create();
+        run(first, 0, 3);
+        first.write_results(buffer);
+    }
+    {
+        auto second = create();
+        run(second, 3, seq1.size());
+        second.write_results(buffer);
+    }
+
+    auto merged = create();
+    merged.merge_results(buffer);
+    merged.merge_results(buffer);
+    merged.sort();
+
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+    EXPECT_EQ(merged.get_counts(), ref.get_counts());
+    EXPECT_EQ(merged.get_combinations(), ref.get_combinations());
+    EXPECT_EQ(merged.get_barcode1_only(), ref.get_barcode1_only());
+    EXPECT_EQ(merged.get_barcode2_only(), ref.get_barcode2_only());
+
+    // Truncating the combinations, after the valid counts have been parsed.
+    // This should not modify the valid counts of the handler either.
+    std::string serialized;
+    {
+        std::stringstream out;
+        ref.write_results(out);
+        serialized = out.str();
+    }
+    auto combo_start = serialized.find("kaori::CombinatorialBarcodesPairedEnd");
+    ASSERT_NE(combo_start, std::string::npos);
+    std::istringstream truncated(serialized.substr(0, combo_start + 45));
+    EXPECT_ANY_THROW(merged.merge_results(truncated));
+
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+    EXPECT_EQ(merged.get_counts(), ref.get_counts());
+    EXPECT_EQ(merged.get_combinations(), ref.get_combinations());
+    EXPECT_EQ(merged.get_barcode1_only(), ref.get_barcode1_only());
+    EXPECT_EQ(merged.get_barcode2_only(), ref.get_barcode2_only());
+}
+
 TEST_F(DualBarcodesWithDiagnosticsTest, WithDuplicates) {
     // Inserting duplicate entries, even though the combinations are unique.
     variables1.push_back("AAAA");
@@ -4,6 +4,9 @@
 #include "byteme/RawBufferReader.hpp"
 #include "../utils.h"
 #include <string>
+#include <type_traits>
+#include <cstdint>
+#include <sstream>
 
 TEST(SingleBarcodeSingleEnd, ForwardOnly) {
     std::string thing = "ACGT----TTTT";
@@ -151,3 +154,185 @@ TEST(SingleBarcodeSingleEnd, Best) {
     }
 }
 
+
+TEST(SingleBarcodeSingleEnd, CountType) {
+    std::string thing = "ACGT----TTTT";
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+    std::vector<std::string> seq{ 
+        "cagcatcgatcgtgaACGTAAAATTTTacggaggaga", 
+        "ACGTCCCCTTTTaaaaccccggg",
+        "ACGTCCCCTTTTaaaaccccggg"
+    };
+    std::string fq = convert_to_fastq(seq);
+
+    kaori::SingleBarcodeSingleEnd<16> handler64(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables));
+    static_assert(std::is_same<typename std::decay<decltype(handler64.get_counts()[0])>::type, uint64_t>::value);
+    static_assert(std::is_same<decltype(handler64.get_total()), uint64_t>::value);
+
+    kaori::SingleBarcodeSingleEnd<16, int> handler32(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables));
+    static_assert(std::is_same<typename std::decay<decltype(handler32.get_counts()[0])>::type, int>::value);
+
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fq.c_str()), fq.size());
+        kaori::process_single_end_data(&reader, handler64);
+    }
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fq.c_str()), fq.size());
+        kaori::process_single_end_data(&reader, handler32);
+    }
+
+    EXPECT_EQ(handler32.get_counts(), std::vector<int>({ 1, 2, 0, 0 }));
+    EXPECT_EQ(handler64.get_counts(), std::vector<uint64_t>({ 1, 2, 0, 0 }));
+    EXPECT_EQ(handler32.get_total(), 3);
+    EXPECT_EQ(handler64.get_total(), 3u);
+}
+
+TEST(SingleBarcodeSingleEnd, RuntimeSize) {
+    std::string thing = "ACGT----TTTT";
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+    std::vector<std::string> seq{ 
+        "cagcatcgatcgtgaACGTAAAATTTTacggaggaga", 
+        "ACGTCCCCTTTTaaaaccccggg",
+        "ccacacacaaaaaACGTAATATTTT",
+        "cAGGTAATATTTTtttttt",
+        "NNNNNACGTGGGGTTTTNNNN",
+        "ccacacacaaaaaAAAATTTTACGTccc" // reverse complement.
+    };
+    std::string fq = convert_to_fastq(seq);
+
+    for (int mm = 0; mm <= 2; ++mm) {
+        kaori::SingleBarcodeSingleEnd<16> ref(thing.c_str(), thing.size(), 2, kaori::BarcodePool(variables), mm);
+        kaori::SingleBarcodeSingleEnd<0> handler(thing.c_str(), thing.size(), 2, kaori::BarcodePool(variables), mm);
+        ref.set_first(false);
+        handler.set_first(false);
+
+        {
+            byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fq.c_str()), fq.size());
+            kaori::process_single_end_data(&reader, ref);
+        }
+        {
+            byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fq.c_str()), fq.size());
+            kaori::process_single_end_data(&reader, handler);
+        }
+
+        EXPECT_EQ(handler.get_counts(), ref.get_counts());
+        EXPECT_EQ(handler.get_total(), ref.get_total());
+    }
+}
+
+TEST(SingleBarcodeSingleEnd, Batch) {
+    std::string thing = "ACGT----TTTT";
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+    std::vector<std::string> seq{ 
+        "cagcatcgatcgtgaACGTAAAATTTTacggaggaga", 
+        "ACGTCCCCTTTTaaaaccccggg",
+        "ccacacacaaaaaACGTAATATTTT",
+        "cAGGTAATATTTTtttttt",
+        "NNNNNACGTGGGGTTTTNNNN",
+        "ACGT",
+        "ccacacacaaaaaAAAATTTTACGTccc" // reverse complement.
+    };
+
+    std::vector<std::pair<const char*, const char*> > reads;
+    for (const auto& s : seq) {
+        reads.emplace_back(s.c_str(), s.c_str() + s.size());
+    }
+
+    for (int mm = 0; mm <= 2; ++mm) {
+        for (bool first : { true, false }) {
+            kaori::SingleBarcodeSingleEnd<16> ref(thing.c_str(), thing.size(), 2, kaori::BarcodePool(variables), mm);
+            kaori::SingleBarcodeSingleEnd<16> handler(thing.c_str(), thing.size(), 2, kaori::BarcodePool(variables), mm);
+            ref.set_first(first);
+            handler.set_first(first);
+
+            auto ref_state = ref.initialize();
+            for (const auto& r : reads) {
+                ref.process(ref_state, r);
+            }
+            ref.reduce(ref_state);
+
+            auto state = handler.initialize();
+            handler.process_batch(state, reads.data(), reads.size());
+            handler.reduce(state);
+
+            EXPECT_EQ(handler.get_counts(), ref.get_counts());
+            EXPECT_EQ(handler.get_total(), ref.get_total());
+        }
+    }
+}
+
+TEST(SingleBarcodeSingleEnd, MergeResults) {
+    std::string thing = "ACGT----TTTT";
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+
+    std::vector<std::string> seq;
+    for (int i = 0; i < 100; ++i) {
+        seq.push_back("cagcatcgACGT" + variables[(i * 7) % 5 % 4] + "TTTTacgg");
+        if (i % 3 == 0) {
+            seq.back()[14] = 'N'; // introducing a mismatch.
+        }
+    }
+    std::string fq = convert_to_fastq(seq);
+
+    kaori::SingleBarcodeSingleEnd<16> ref(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables), 1);
+    kaori::process_single_end_buffer(fq.c_str(), fq.size(), ref);
+
+    // Processing each shard separately, as if they were on different machines.
+    size_t nshards = 3;
+    std::vector<std::string> serialized;
+    for (size_t s = 0; s < nshards; ++s) {
+        auto range = kaori::find_fastq_shard(fq.c_str(), fq.size(), s, nshards);
+        kaori::SingleBarcodeSingleEnd<16> handler(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables), 1);
+        kaori::process_single_end_buffer(fq.c_str() + range.first, range.second - range.first, handler);
+        EXPECT_LT(handler.get_total(), ref.get_total());
+
+        std::ostringstream out;
+        handler.write_results(out);
+        serialized.push_back(out.str());
+    }
+
+    kaori::SingleBarcodeSingleEnd<16> merged(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables), 1);
+    for (const auto& x : serialized) {
+        std::istringstream in(x);
+        merged.merge_results(in);
+    }
+    EXPECT_EQ(merged.get_counts(), ref.get_counts());
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+
+    // Errors for incompatible results.
+    {
+        kaori::SingleBarcodeSingleEnd<16> other(thing.c_str(), thing.size(), 0, kaori::BarcodePool(std::vector<std::string>{ "AAAA" }));
+        std::istringstream in(serialized.front());
+        EXPECT_ANY_THROW({
+            try {
+                other.merge_results(in);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("different number") != std::string::npos);
+                throw e;
+            }
+        });
+        EXPECT_EQ(other.get_counts(), std::vector<uint64_t>{ 0 });
+        EXPECT_EQ(other.get_total(), 0);
+    }
+
+    {
+        std::istringstream in("kaori::DualBarcodes 1\n");
+        EXPECT_ANY_THROW({
+            try {
+                merged.merge_results(in);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("compatible") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    {
+        std::istringstream in(serialized.front().substr(0, serialized.front().size() / 2));
+        EXPECT_ANY_THROW(merged.merge_results(in));
+    }
+
+    // Failed merges should not modify the handler.
+    EXPECT_EQ(merged.get_counts(), ref.get_counts());
+    EXPECT_EQ(merged.get_total(), ref.get_total());
+}
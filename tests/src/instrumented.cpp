@@ -0,0 +1,93 @@
+// This is compiled into a separate executable, as KAORI_INSTRUMENT changes the
+// layout of the search classes and must be consistent across translation units.
+#ifndef KAORI_INSTRUMENT
+#define KAORI_INSTRUMENT
+#endif
+
+#include <gtest/gtest.h>
+#include "kaori/handlers/SingleBarcodeSingleEnd.hpp"
+#include "kaori/handlers/DualBarcodes.hpp"
+#include "kaori/process_data.hpp"
+#include "byteme/RawBufferReader.hpp"
+#include "utils.h"
+#include <string>
+
+TEST(Instrumented, SimpleSearch) {
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+    kaori::SimpleBarcodeSearch stuff(kaori::BarcodePool(variables), 1);
+
+    auto state = stuff.initialize();
+    stuff.search("AAAA", state);
+    stuff.search("CCCC", state);
+    stuff.search("AAAT", state); // goes through the trie.
+    stuff.search("AAAT", state); // in the thread-specific cache.
+    stuff.search("ACGT", state); // no match, but still cached.
+    stuff.reduce(state);
+
+    auto state2 = stuff.initialize();
+    stuff.search("AAAT", state2); // in the shared cache.
+    stuff.search("ACGT", state2);
+    stuff.reduce(state2);
+
+    const auto& stats = stuff.get_stats();
+    EXPECT_EQ(stats.searches, 7u);
+    EXPECT_EQ(stats.exact_hits, 2u);
+    EXPECT_EQ(stats.trie_searches, 2u);
+    EXPECT_EQ(stats.cache_hits, 3u);
+    EXPECT_DOUBLE_EQ(stats.cache_hit_rate(), 0.6);
+
+    // No template scanning here, only the trie searches are timed.
+    EXPECT_GT(stats.trie_time.count(), 0);
+    EXPECT_EQ(stats.scan_time.count(), 0);
+}
+
+TEST(Instrumented, SingleBarcodeSingleEnd) {
+    std::string thing = "ACGT----TTTT";
+    std::vector<std::string> variables { "AAAA", "CCCC", "GGGG", "TTTT" };
+
+    std::vector<std::string> seq;
+    for (int i = 0; i < 10; ++i) {
+        seq.push_back("cagcatcgatcgtgaACGTAAAATTTTacggaggaga");
+        seq.push_back("ccacacacaaaaaACGTAATATTTT"); // 1 mismatch
+    }
+    std::string fq = convert_to_fastq(seq);
+
+    kaori::SingleBarcodeSingleEnd<16> handler(thing.c_str(), thing.size(), 0, kaori::BarcodePool(variables), 1);
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fq.c_str()), fq.size());
+    kaori::process_single_end_data(&reader, handler, 1, 4);
+
+    EXPECT_EQ(handler.get_counts()[0], 20u);
+    auto stats = handler.get_stats();
+    EXPECT_EQ(stats.searches, stats.exact_hits + stats.cache_hits + stats.trie_searches);
+    EXPECT_EQ(stats.exact_hits, 10u);
+    EXPECT_EQ(stats.cache_hits + stats.trie_searches, 10u);
+
+    // Most of the mismatched reads should come from the cache, but each
+    // state may need to search the trie before the shared cache is updated.
+    EXPECT_GE(stats.trie_searches, 1u);
+    EXPECT_LT(stats.trie_searches, 5u);
+
+    EXPECT_GT(stats.trie_time.count(), 0);
+    EXPECT_GE(stats.scan_time, stats.trie_time);
+}
+
+TEST(Instrumented, DualBarcodes) {
+    std::string constant1 = "AAAA----CGGC", constant2 = "AGCT------TTTT";
+    std::vector<std::string> variables1 { "AAAA", "CCCC", "GGGG", "TTTT" };
+    std::vector<std::string> variables2 { "ACACAC", "TGTGTG", "AGAGAG", "CTCTCT" };
+
+    kaori::DualBarcodes<32> handler(
+        constant1.c_str(), constant1.size(), false, kaori::BarcodePool(variables1), 1,
+        constant2.c_str(), constant2.size(), false, kaori::BarcodePool(variables2), 1
+    );
+
+    auto state = handler.initialize();
+    std::string seq1 = "AAAATTTTCGGC", seq2 = "AGCTCTCTCTTTTT";
+    handler.process(state, std::make_pair(seq1.c_str(), seq1.c_str() + seq1.size()), std::make_pair(seq2.c_str(), seq2.c_str() + seq2.size()));
+    handler.reduce(state);
+
+    auto stats = handler.get_stats();
+    EXPECT_GE(stats.searches, 1u);
+    EXPECT_EQ(stats.exact_hits, 1u);
+    EXPECT_GT(stats.scan_time.count(), 0);
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "kaori/process_data.hpp"
 #include <random>
+#include <algorithm>
 #include "byteme/RawBufferReader.hpp"
 #include "utils.h"
 
@@ -133,6 +134,58 @@ TEST_P(ProcessDataTester, SingleEndErrors) {
     });
 }
 
+TEST_P(ProcessDataTester, SingleEndBuffer) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads = simulate_reads(nthreads + blocksize);
+
+    // Using qualities that start with '@' or '+' to check that the record
+    // boundaries are correctly identified in each chunk.
+    std::string fastq_str;
+    for (size_t i = 0; i < reads.size(); ++i) {
+        fastq_str += "@READ" + std::to_string(i + 1) + "\n";
+        fastq_str += reads[i] + "\n";
+        fastq_str += "+\n";
+        std::string qual(reads[i].size(), '!');
+        qual[0] = (i % 3 == 0 ? '@' : (i % 3 == 1 ? '+' : '!'));
+        fastq_str += qual + "\n";
+    }
+
+    for (size_t chunk_size : { static_cast<size_t>(blocksize), static_cast<size_t>(blocksize * 50), fastq_str.size() }) {
+        {
+            SingleEndCollector<false> task;
+            kaori::process_single_end_buffer(fastq_str.c_str(), fastq_str.size(), task, nthreads, chunk_size);
+            EXPECT_EQ(task.collected_reads, reads);
+            EXPECT_TRUE(task.collected_names.empty());
+        }
+
+        {
+            SingleEndCollector<true> task;
+            kaori::process_single_end_buffer(fastq_str.c_str(), fastq_str.size(), task, nthreads, chunk_size);
+            EXPECT_EQ(task.collected_reads, reads);
+            ASSERT_EQ(task.collected_names.size(), reads.size());
+            for (size_t i = 0; i < task.collected_names.size(); ++i) {
+                EXPECT_EQ(task.collected_names[i], "READ" + std::to_string(i + 1));
+            }
+        }
+    }
+
+    // Errors are propagated correctly.
+    {
+        SingleEndCollector<false, true> task;
+        EXPECT_ANY_THROW({
+            try {
+                kaori::process_single_end_buffer(fastq_str.c_str(), fastq_str.size(), task, nthreads, blocksize * 50);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()) == "I want a burger");
+                throw e;
+            }
+        });
+    }
+}
+
 template<bool unames, bool failtest = false>
 class PairedEndCollector {
 public:
@@ -270,6 +323,485 @@ TEST_P(ProcessDataTester, PairedEndErrors) {
     }
 }
 
+TEST_P(ProcessDataTester, PairedEndInterleaved) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+
+    std::string fastq_str;
+    for (size_t i = 0; i < reads1.size(); ++i) {
+        fastq_str += "@FOO" + std::to_string(i + 1) + "\n" + reads1[i] + "\n+\n" + std::string(reads1[i].size(), '!') + "\n";
+        fastq_str += "@BAR" + std::to_string(i + 1) + "\n" + reads2[i] + "\n+\n" + std::string(reads2[i].size(), '!') + "\n";
+    }
+
+    // Without names.
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str.c_str()), fastq_str.size());
+
+        PairedEndCollector<false> task;
+        kaori::process_paired_end_data(&reader, task, nthreads, blocksize);
+
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        EXPECT_EQ(task.read2.collected_reads, reads2);
+        EXPECT_TRUE(task.read1.collected_names.empty());
+        EXPECT_TRUE(task.read2.collected_names.empty());
+    }
+
+    // Plus names.
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str.c_str()), fastq_str.size());
+
+        PairedEndCollector<true> task;
+        kaori::process_paired_end_data(&reader, task, nthreads, blocksize);
+
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        EXPECT_EQ(task.read2.collected_reads, reads2);
+        EXPECT_EQ(task.read1.collected_names.size(), reads1.size());
+        EXPECT_EQ(task.read2.collected_names.size(), reads2.size());
+
+        bool all_okay = true;
+        for (size_t i = 0; i < reads1.size(); ++i) {
+            if (task.read1.collected_names[i] != "FOO" + std::to_string(i + 1)) {
+                all_okay = false;
+            }
+            if (task.read2.collected_names[i] != "BAR" + std::to_string(i + 1)) { 
+                all_okay = false;
+            }
+        }
+        EXPECT_TRUE(all_okay);
+    }
+
+    // Errors out correctly due to an unpaired read.
+    {
+        auto fastq_str3 = fastq_str + "@FOO\nACGT\n+\n!!!!\n";
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str3.c_str()), fastq_str3.size());
+
+        PairedEndCollector<false> task;
+        EXPECT_ANY_THROW({
+            try {
+                kaori::process_paired_end_data(&reader, task, nthreads, blocksize);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("odd number of reads") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+}
+
+TEST_P(ProcessDataTester, Windows) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+    auto fastq_str1 = convert_to_fastq(reads1, "FOO");
+    auto fastq_str2 = convert_to_fastq(reads2, "BAR");
+
+    // Reads are between 10 and 30 bp, so some of them are truncated by the window.
+    size_t start = 5, end = 20;
+    auto window = [&](std::vector<std::string> reads) -> std::vector<std::string> {
+        for (auto& r : reads) {
+            r = r.substr(start, end - start);
+        }
+        return reads;
+    };
+
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        kaori::process_single_end_data(&reader, task, nthreads, blocksize, start, end);
+        EXPECT_EQ(task.collected_reads, window(reads1));
+    }
+
+    {
+        SingleEndCollector<false> task;
+        kaori::process_single_end_buffer(fastq_str1.c_str(), fastq_str1.size(), task, nthreads, blocksize * 50, start, end);
+        EXPECT_EQ(task.collected_reads, window(reads1));
+    }
+
+    {
+        byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fastq_str2.c_str()), fastq_str2.size());
+        PairedEndCollector<false> task;
+        kaori::process_paired_end_data(&reader1, &reader2, task, nthreads, blocksize, start, end);
+        EXPECT_EQ(task.read1.collected_reads, window(reads1));
+        EXPECT_EQ(task.read2.collected_reads, window(reads2));
+    }
+
+    // Window starting past the end of all reads.
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        kaori::process_single_end_data(&reader, task, nthreads, blocksize, 100, 200);
+        EXPECT_EQ(task.collected_reads, std::vector<std::string>(reads1.size()));
+    }
+
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        EXPECT_ANY_THROW({
+            try {
+                kaori::process_single_end_data(&reader, task, nthreads, blocksize, 20, 10);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("window start") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+}
+
+TEST_P(ProcessDataTester, SharedPool) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+    auto fastq_str1 = convert_to_fastq(reads1, "FOO");
+    auto fastq_str2 = convert_to_fastq(reads2, "BAR");
+
+    // Same pool is used for multiple runs.
+    kaori::ThreadPool pool(nthreads);
+
+    for (int it = 0; it < 2; ++it) {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<true> task;
+        kaori::process_single_end_data(&reader, task, pool, blocksize);
+        EXPECT_EQ(task.collected_reads, reads1);
+        EXPECT_EQ(task.collected_names.size(), reads1.size());
+    }
+
+    {
+        SingleEndCollector<false> task;
+        kaori::process_single_end_buffer(fastq_str1.c_str(), fastq_str1.size(), task, pool, blocksize * 50);
+        EXPECT_EQ(task.collected_reads, reads1);
+    }
+
+    {
+        byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fastq_str2.c_str()), fastq_str2.size());
+        PairedEndCollector<false> task;
+        kaori::process_paired_end_data(&reader1, &reader2, task, pool, blocksize);
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        EXPECT_EQ(task.read2.collected_reads, reads2);
+    }
+
+    // Pool is still usable after an error.
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false, true> task;
+        EXPECT_ANY_THROW(kaori::process_single_end_data(&reader, task, pool, blocksize));
+    }
+
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        kaori::process_single_end_data(&reader, task, pool, blocksize);
+        EXPECT_EQ(task.collected_reads, reads1);
+    }
+}
+
+TEST_P(ProcessDataTester, BlockSizing) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+    auto fastq_str1 = convert_to_fastq(reads1, "FOO");
+    auto fastq_str2 = convert_to_fastq(reads2, "BAR");
+
+    std::vector<kaori::BlockSize> options;
+    options.push_back(kaori::BlockSize(blocksize).set_max_bytes(blocksize * 5).set_min_reads(blocksize / 2));
+    options.push_back(kaori::BlockSize(blocksize * 10).set_adaptive().set_min_reads(blocksize));
+    options.push_back(kaori::BlockSize(blocksize * 10).set_adaptive().set_target_time(0).set_min_reads(1)); // forces the smallest blocks.
+
+    for (const auto& opt : options) {
+        {
+            byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+            SingleEndCollector<true> task;
+            kaori::process_single_end_data(&reader, task, nthreads, opt);
+            EXPECT_EQ(task.collected_reads, reads1);
+            EXPECT_EQ(task.collected_names.size(), reads1.size());
+        }
+
+        {
+            byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+            byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fastq_str2.c_str()), fastq_str2.size());
+            PairedEndCollector<false> task;
+            kaori::process_paired_end_data(&reader1, &reader2, task, nthreads, opt);
+            EXPECT_EQ(task.read1.collected_reads, reads1);
+            EXPECT_EQ(task.read2.collected_reads, reads2);
+        }
+
+        {
+            std::string interleaved;
+            for (size_t i = 0; i < reads1.size(); ++i) {
+                interleaved += convert_to_fastq(std::vector<std::string>{ reads1[i], reads2[i] }, "FOO");
+            }
+            byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(interleaved.c_str()), interleaved.size());
+            PairedEndCollector<false> task;
+            kaori::process_paired_end_data(&reader, task, nthreads, opt);
+            EXPECT_EQ(task.read1.collected_reads, reads1);
+            EXPECT_EQ(task.read2.collected_reads, reads2);
+        }
+    }
+}
+
+class FlushingCollector {
+public:
+    struct State {
+        std::vector<std::string> reads;
+    };
+
+    void process(State& state, const std::pair<const char*, const char*>& x) const {
+        state.reads.emplace_back(x.first, x.second);
+    }
+
+    State initialize() {
+        ++ninitialized;
+        return State();
+    }
+
+    void flush(State&) {
+        ++nflushed;
+    }
+
+    void reduce(State& x) {
+        ++nreduced;
+        collected_reads.insert(collected_reads.end(), x.reads.begin(), x.reads.end());
+    }
+
+    static constexpr bool use_names = false;
+
+    std::vector<std::string> collected_reads;
+    int ninitialized = 0, nflushed = 0, nreduced = 0;
+};
+
+TEST_P(ProcessDataTester, PersistentState) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto fastq_str1 = convert_to_fastq(reads1, "FOO");
+
+    byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+    FlushingCollector task;
+    kaori::process_single_end_data(&reader, task, nthreads, blocksize);
+
+    // Each block is flushed, but states are only initialized and reduced once.
+    EXPECT_EQ(task.nflushed, static_cast<int>(reads1.size() / blocksize + 1));
+    EXPECT_EQ(task.ninitialized, task.nreduced);
+    EXPECT_LT(task.nreduced, task.nflushed);
+
+    // Order is not preserved across states, but the contents should be the same.
+    auto collected = task.collected_reads;
+    std::sort(collected.begin(), collected.end());
+    std::sort(reads1.begin(), reads1.end());
+    EXPECT_EQ(collected, reads1);
+}
+
+TEST_P(ProcessDataTester, Progress) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+    auto fastq_str1 = convert_to_fastq(reads1, "FOO");
+    auto fastq_str2 = convert_to_fastq(reads2, "BAR");
+
+    size_t total_bytes = 0;
+    for (const auto& r : reads1) {
+        total_bytes += r.size();
+    }
+
+    std::vector<kaori::Progress> history;
+    kaori::ProgressCallback observer = [&](const kaori::Progress& p) -> bool {
+        history.push_back(p);
+        return true;
+    };
+
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        kaori::process_single_end_data(&reader, task, nthreads, blocksize, 0, std::numeric_limits<size_t>::max(), observer);
+        EXPECT_EQ(task.collected_reads, reads1);
+
+        ASSERT_EQ(history.size(), reads1.size() / blocksize + 1);
+        for (size_t i = 0; i < history.size(); ++i) {
+            EXPECT_EQ(history[i].blocks, i + 1);
+            if (i) {
+                EXPECT_GE(history[i].reads, history[i - 1].reads);
+                EXPECT_GE(history[i].elapsed, history[i - 1].elapsed);
+            }
+            EXPECT_GE(history[i].parse_time, 0);
+            EXPECT_GE(history[i].process_time, 0);
+        }
+        EXPECT_EQ(history.back().reads, reads1.size());
+        EXPECT_EQ(history.back().bytes, total_bytes);
+    }
+
+    {
+        history.clear();
+        SingleEndCollector<false> task;
+        kaori::process_single_end_buffer(fastq_str1.c_str(), fastq_str1.size(), task, nthreads, blocksize * 50, 0, std::numeric_limits<size_t>::max(), observer);
+        EXPECT_EQ(task.collected_reads, reads1);
+        ASSERT_FALSE(history.empty());
+        EXPECT_EQ(history.back().reads, reads1.size());
+        EXPECT_EQ(history.back().bytes, total_bytes);
+    }
+
+    {
+        history.clear();
+        byteme::RawBufferReader reader1(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        byteme::RawBufferReader reader2(reinterpret_cast<const unsigned char*>(fastq_str2.c_str()), fastq_str2.size());
+        PairedEndCollector<false> task;
+        kaori::process_paired_end_data(&reader1, &reader2, task, nthreads, blocksize, 0, std::numeric_limits<size_t>::max(), observer);
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        ASSERT_FALSE(history.empty());
+        EXPECT_EQ(history.back().reads, reads1.size());
+    }
+
+    // Stopping early after the first block; anything already parsed is still
+    // processed, so we get a prefix of the reads.
+    {
+        byteme::RawBufferReader reader(reinterpret_cast<const unsigned char*>(fastq_str1.c_str()), fastq_str1.size());
+        SingleEndCollector<false> task;
+        int ncalls = 0;
+        kaori::process_single_end_data(&reader, task, nthreads, blocksize, 0, std::numeric_limits<size_t>::max(), 
+            [&](const kaori::Progress&) -> bool {
+                ++ncalls;
+                return false;
+            }
+        );
+
+        EXPECT_GE(task.collected_reads.size(), static_cast<size_t>(blocksize));
+        EXPECT_LT(task.collected_reads.size(), reads1.size());
+        std::vector<std::string> expected(reads1.begin(), reads1.begin() + task.collected_reads.size());
+        EXPECT_EQ(task.collected_reads, expected);
+        EXPECT_EQ(static_cast<size_t>(ncalls), task.collected_reads.size() / blocksize + (task.collected_reads.size() % blocksize > 0));
+    }
+}
+
+TEST_P(ProcessDataTester, InMemoryReads) {
+    auto param = GetParam();
+    auto nthreads = std::get<0>(param);
+    auto blocksize = std::get<1>(param);
+
+    auto reads1 = simulate_reads(nthreads + blocksize);
+    auto reads2 = simulate_reads((nthreads + blocksize) * 2);
+
+    std::vector<std::string> names1, names2;
+    for (size_t i = 0; i < reads1.size(); ++i) {
+        names1.push_back("FOO" + std::to_string(i + 1));
+        names2.push_back("BAR" + std::to_string(i + 1));
+    }
+
+    auto pointers = [](const std::vector<std::string>& x) -> std::vector<const char*> {
+        std::vector<const char*> output;
+        for (const auto& y : x) {
+            output.push_back(y.c_str());
+        }
+        return output;
+    };
+    auto lengths = [](const std::vector<std::string>& x) -> std::vector<size_t> {
+        std::vector<size_t> output;
+        for (const auto& y : x) {
+            output.push_back(y.size());
+        }
+        return output;
+    };
+
+    auto sptr1 = pointers(reads1), sptr2 = pointers(reads2), nptr1 = pointers(names1), nptr2 = pointers(names2);
+    auto slen1 = lengths(reads1), slen2 = lengths(reads2), nlen1 = lengths(names1), nlen2 = lengths(names2);
+    kaori::ReadArray arr1(reads1.size(), sptr1.data(), slen1.data(), nptr1.data(), nlen1.data());
+    kaori::ReadArray arr2(reads2.size(), sptr2.data(), slen2.data(), nptr2.data(), nlen2.data());
+
+    {
+        SingleEndCollector<false> task;
+        kaori::process_single_end_reads(arr1, task, nthreads, blocksize);
+        EXPECT_EQ(task.collected_reads, reads1);
+        EXPECT_TRUE(task.collected_names.empty());
+    }
+
+    {
+        SingleEndCollector<true> task;
+        kaori::process_single_end_reads(arr1, task, nthreads, blocksize);
+        EXPECT_EQ(task.collected_reads, reads1);
+        EXPECT_EQ(task.collected_names, names1);
+    }
+
+    {
+        PairedEndCollector<false> task;
+        kaori::process_paired_end_reads(arr1, arr2, task, nthreads, blocksize);
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        EXPECT_EQ(task.read2.collected_reads, reads2);
+    }
+
+    {
+        PairedEndCollector<true> task;
+        kaori::process_paired_end_reads(arr1, arr2, task, nthreads, blocksize);
+        EXPECT_EQ(task.read1.collected_reads, reads1);
+        EXPECT_EQ(task.read2.collected_reads, reads2);
+        EXPECT_EQ(task.read1.collected_names, names1);
+        EXPECT_EQ(task.read2.collected_names, names2);
+    }
+
+    // Respects the window.
+    {
+        SingleEndCollector<false> task;
+        kaori::process_single_end_reads(arr1, task, nthreads, blocksize, 5, 20);
+        ASSERT_EQ(task.collected_reads.size(), reads1.size());
+        bool all_okay = true;
+        for (size_t i = 0; i < reads1.size(); ++i) {
+            if (task.collected_reads[i] != reads1[i].substr(5, 15)) {
+                all_okay = false;
+            }
+        }
+        EXPECT_TRUE(all_okay);
+    }
+
+    // Errors for missing names or mismatched lengths.
+    {
+        SingleEndCollector<true> task;
+        kaori::ReadArray nonames(reads1.size(), sptr1.data(), slen1.data());
+        EXPECT_ANY_THROW({
+            try {
+                kaori::process_single_end_reads(nonames, task, nthreads, blocksize);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("names") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    {
+        PairedEndCollector<false> task;
+        kaori::ReadArray truncated(reads2.size() - 1, sptr2.data(), slen2.data());
+        EXPECT_ANY_THROW({
+            try {
+                kaori::process_paired_end_reads(arr1, truncated, task, nthreads, blocksize);
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("different number") != std::string::npos);
+                throw e;
+            }
+        });
+    }
+
+    // No-op for empty inputs.
+    {
+        SingleEndCollector<false> task;
+        kaori::process_single_end_reads(kaori::ReadArray(), task, nthreads, blocksize);
+        EXPECT_TRUE(task.collected_reads.empty());
+    }
+}
+
 INSTANTIATE_TEST_SUITE_P(
     ProcessData,
     ProcessDataTester, 